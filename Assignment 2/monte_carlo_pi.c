@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+// Monte Carlo estimate of pi with a counter-based random number generator
+//
+// Usage: monte_carlo_pi [niter] [seed]
+//        monte_carlo_pi threads <niter> <threads...>   (table for plot.py)
+//        monte_carlo_pi niter <from> <to> [threads]    (table for plot2.py)
+//
+// Random numbers come from Philox4x32-10: sample pair b is a pure function of
+// the counter b and the seed, so there is no generator state to share or to
+// seed per thread, and the estimate is bit-identical for every thread count.
+// The counters are cut into fixed chunks that the threads share statically,
+// every thread counts hits in a private variable, and the inner loop over a
+// chunk is an OpenMP simd loop, so each vector lane runs its own Philox
+// stream. Build with e.g. gcc -O3 -march=native -fopenmp.
+//
+// The table modes print "threads time" or "niter time" lines; redirect them
+// to threads.txt or niter.txt and plot.py / plot2.py pick them up.
+
+#define DEFAULT_NITER 1000000000ULL
+#define DEFAULT_SEED 2024
+#define CHUNK_PAIRS 8192      // Counters per scheduling chunk, each gives two points
+#define REPETITIONS 3         // Best of this many runs goes into a table
+
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+#define PHILOX_ROUNDS 10
+
+// Function prototypes
+uint64_t count_hits(uint64_t niter, uint64_t seed);
+double estimate_pi(uint64_t niter, uint64_t seed, int threads, double *elapsed);
+void print_threads_table(uint64_t niter, int count, char **threads);
+void print_niter_table(uint64_t from, uint64_t to, int threads);
+
+// One Philox4x32-10 block: four random words for a counter and a key
+static inline void philox4x32(uint64_t counter, uint64_t seed, uint32_t out[4]) {
+    uint32_t c0 = (uint32_t)counter, c1 = (uint32_t)(counter >> 32), c2 = 0, c3 = 0;
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+        c0 = n0;
+        c2 = n2;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+// 1 if the point given by two random words lies inside the quarter circle
+static inline uint32_t inside_circle(uint32_t rx, uint32_t ry) {
+    const double scale = 1.0 / 4294967296.0;
+    double x = rx * scale, y = ry * scale;
+    return x * x + y * y < 1.0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "threads") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "Usage: %s threads <niter> <threads...>\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        print_threads_table(strtoull(argv[2], NULL, 10), argc - 3, argv + 3);
+        return EXIT_SUCCESS;
+    }
+    if (argc > 1 && strcmp(argv[1], "niter") == 0) {
+        if (argc < 4 || argc > 5) {
+            fprintf(stderr, "Usage: %s niter <from> <to> [threads]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        int threads = argc > 4 ? atoi(argv[4]) : omp_get_max_threads();
+        print_niter_table(strtoull(argv[2], NULL, 10), strtoull(argv[3], NULL, 10), threads);
+        return EXIT_SUCCESS;
+    }
+    if (argc > 3) {
+        fprintf(stderr, "Usage: %s [niter] [seed]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t niter = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_NITER;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 10) : DEFAULT_SEED;
+    if (niter == 0) {
+        fprintf(stderr, "niter must be positive.\n");
+        return EXIT_FAILURE;
+    }
+
+    double elapsed;
+    double pi = estimate_pi(niter, seed, omp_get_max_threads(), &elapsed);
+    printf("niter = %llu, threads = %d\n", (unsigned long long)niter, omp_get_max_threads());
+    printf("pi ~ %.10f (error %.3e)\n", pi, fabs(pi - M_PI));
+    printf("Computation time: %f seconds\n", elapsed);
+    return EXIT_SUCCESS;
+}
+
+// Number of the first niter points that fall inside the quarter circle
+uint64_t count_hits(uint64_t niter, uint64_t seed) {
+    uint64_t pairs = niter / 2;
+    uint64_t chunks = (pairs + CHUNK_PAIRS - 1) / CHUNK_PAIRS;
+    uint64_t hits = 0;
+
+    #pragma omp parallel for schedule(static) reduction(+ : hits)
+    for (uint64_t chunk = 0; chunk < chunks; chunk++) {
+        uint64_t first = chunk * CHUNK_PAIRS;
+        uint64_t last = first + CHUNK_PAIRS < pairs ? first + CHUNK_PAIRS : pairs;
+        uint32_t chunk_hits = 0;
+        #pragma omp simd reduction(+ : chunk_hits)
+        for (uint64_t counter = first; counter < last; counter++) {
+            uint32_t r[4];
+            philox4x32(counter, seed, r);
+            chunk_hits += inside_circle(r[0], r[1]) + inside_circle(r[2], r[3]);
+        }
+        hits += chunk_hits;
+    }
+
+    // An odd niter uses the first point of one more pair
+    if (niter % 2 == 1) {
+        uint32_t r[4];
+        philox4x32(pairs, seed, r);
+        hits += inside_circle(r[0], r[1]);
+    }
+    return hits;
+}
+
+// Estimate pi with the given number of threads, timing the computation
+double estimate_pi(uint64_t niter, uint64_t seed, int threads, double *elapsed) {
+    omp_set_num_threads(threads);
+    double start = omp_get_wtime();
+    uint64_t hits = count_hits(niter, seed);
+    *elapsed = omp_get_wtime() - start;
+    return 4.0 * (double)hits / (double)niter;
+}
+
+// Time a fixed niter for every listed thread count
+void print_threads_table(uint64_t niter, int count, char **threads) {
+    printf("# threads time (niter = %llu)\n", (unsigned long long)niter);
+    for (int t = 0; t < count; t++) {
+        int num_threads = atoi(threads[t]);
+        double best = INFINITY, elapsed;
+        for (int r = 0; r < REPETITIONS; r++) {
+            estimate_pi(niter, DEFAULT_SEED, num_threads, &elapsed);
+            best = elapsed < best ? elapsed : best;
+        }
+        printf("%d %f\n", num_threads, best);
+        fflush(stdout);
+    }
+}
+
+// Time every niter from "from" to "to", doubling each step
+void print_niter_table(uint64_t from, uint64_t to, int threads) {
+    printf("# niter time (threads = %d)\n", threads);
+    for (uint64_t niter = from; niter > 0 && niter <= to; niter *= 2) {
+        double best = INFINITY, elapsed;
+        for (int r = 0; r < REPETITIONS; r++) {
+            estimate_pi(niter, DEFAULT_SEED, threads, &elapsed);
+            best = elapsed < best ? elapsed : best;
+        }
+        printf("%llu %f\n", (unsigned long long)niter, best);
+        fflush(stdout);
+    }
+}
@@ -1,9 +1,18 @@
+import os
+import sys
 import matplotlib.pyplot as plt
 
 # Data from the job output
 threads = [8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48]
 times = [2.192591, 1.500027, 1.093880, 0.873364, 0.746132, 0.623460, 0.546192, 0.736210, 0.700426, 0.697526, 0.650290]
 
+# A table from "monte_carlo_pi threads <niter> <threads...>" replaces it if present
+table = sys.argv[1] if len(sys.argv) > 1 else 'threads.txt'
+if os.path.exists(table):
+    rows = [line.split() for line in open(table) if line.strip() and not line.startswith('#')]
+    threads = [int(row[0]) for row in rows]
+    times = [float(row[1]) for row in rows]
+
 # Plotting
 plt.figure(figsize=(10, 6))
 plt.plot(threads, times, marker='o', linestyle='-', label='Execution Time')
@@ -1,9 +1,18 @@
+import os
+import sys
 import matplotlib.pyplot as plt
 
 # Data from the job output
 niter_values = [31250000, 62500000, 125000000, 250000000, 500000000, 1000000000, 2000000000]
 times = [0.050304, 0.074019, 0.137993, 0.164190, 0.298904, 0.560521, 1.487956]
 
+# A table from "monte_carlo_pi niter <from> <to>" replaces it if present
+table = sys.argv[1] if len(sys.argv) > 1 else 'niter.txt'
+if os.path.exists(table):
+    rows = [line.split() for line in open(table) if line.strip() and not line.startswith('#')]
+    niter_values = [int(row[0]) for row in rows]
+    times = [float(row[1]) for row in rows]
+
 # Plotting
 plt.figure(figsize=(10, 6))
 plt.plot(niter_values, times, marker='o', linestyle='-', label='Computation Time')
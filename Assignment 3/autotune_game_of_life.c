@@ -0,0 +1,408 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <omp.h>
+#include "grower.h"
+#include "glider.h"
+#include "beehive.h"
+
+// Autotuning Game of Life engine
+//
+// Usage: autotune_game_of_life [size] [density] [pattern] [iterations] [retune]
+//   pattern is one of random, grower, glider, beehive (density only applies to random)
+//
+// Before the production run the engine looks up the fastest configuration for
+// this machine and problem shape in a small text database. On a miss (or when
+// "retune" is given) it briefly benchmarks candidate kernels, tile sizes,
+// schedules and thread counts, and stores the winner for the next run.
+
+#define DEFAULT_SIZE 3000
+#define DEFAULT_DENSITY 0.0
+#define DEFAULT_ITERATIONS 5000
+#define DEFAULT_TUNING_DB "gol_tuning.db"
+#define BENCH_GENERATIONS 5
+#define TUNING_PASSES 2
+#define COLSUM_CHUNK 512
+#define MAX_CANDIDATES 32
+
+typedef enum { KERNEL_LOOP, KERNEL_UNROLLED, KERNEL_COLSUM, NUM_KERNELS } kernel_t;
+
+const char *kernel_names[NUM_KERNELS] = {"loop", "unrolled", "colsum"};
+const int tile_sizes[] = {0, 32, 128, 512}; // 0 = whole rows
+const omp_sched_t schedules[] = {omp_sched_static, omp_sched_dynamic, omp_sched_guided};
+const char *schedule_names[] = {"static", "dynamic", "guided"};
+
+#define NUM_TILES ((int)(sizeof(tile_sizes) / sizeof(tile_sizes[0])))
+#define NUM_SCHEDULES ((int)(sizeof(schedules) / sizeof(schedules[0])))
+
+// One point in the search space
+typedef struct {
+    int kernel;
+    int tile;
+    int schedule;
+    int threads;
+} config_t;
+
+// The board is stored with a one cell dead border so no kernel needs bounds checks
+typedef struct {
+    int size;
+    int stride;
+    uint8_t *cells;
+    uint8_t *next_cells;
+} board_t;
+
+// Function prototypes
+void board_init(board_t *board, int size, double density, const char *pattern);
+void board_free(board_t *board);
+void board_step(board_t *board, config_t config);
+long board_population(board_t *board);
+void step_tile(int kernel, const uint8_t *src, uint8_t *dst, int stride, int r0, int r1, int c0, int c1);
+double benchmark(board_t *board, config_t config);
+config_t autotune(board_t *board);
+int lookup_config(const char *db_path, const char *machine, int size, double density, const char *pattern, config_t *config);
+void store_config(const char *db_path, const char *machine, int size, double density, const char *pattern, config_t config, double seconds);
+void describe_config(config_t config);
+
+int main(int argc, char **argv) {
+    int size = argc > 1 ? atoi(argv[1]) : DEFAULT_SIZE;
+    double density = argc > 2 ? atof(argv[2]) : DEFAULT_DENSITY;
+    const char *pattern = argc > 3 ? argv[3] : "grower";
+    int iterations = argc > 4 ? atoi(argv[4]) : DEFAULT_ITERATIONS;
+    int retune = argc > 5 && strcmp(argv[5], "retune") == 0;
+
+    if (size < 1 || iterations < 0 || density < 0.0 || density > 1.0) {
+        fprintf(stderr, "Usage: %s [size] [density] [pattern] [iterations] [retune]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char *db_path = getenv("GOL_TUNING_DB");
+    if (db_path == NULL) {
+        db_path = DEFAULT_TUNING_DB;
+    }
+
+    // The machine key is the host name plus the number of cores it offers us
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    char machine[300];
+    snprintf(machine, sizeof(machine), "%s/%d", host, omp_get_num_procs());
+
+    board_t board;
+    board_init(&board, size, density, pattern);
+
+    config_t config;
+    if (!retune && lookup_config(db_path, machine, size, density, pattern, &config)) {
+        printf("Using tuned configuration from %s: ", db_path);
+        describe_config(config);
+    } else {
+        printf("Tuning for %s, size %d, density %.3f, pattern %s...\n", machine, size, density, pattern);
+        config = autotune(&board);
+        double seconds = benchmark(&board, config);
+        store_config(db_path, machine, size, density, pattern, config, seconds);
+        printf("Selected: ");
+        describe_config(config);
+
+        // Tuning advanced the board, start the production run from scratch
+        board_free(&board);
+        board_init(&board, size, density, pattern);
+    }
+
+    double start = omp_get_wtime();
+    for (int iter = 0; iter < iterations; iter++) {
+        board_step(&board, config);
+    }
+    double elapsed = omp_get_wtime() - start;
+
+    printf("Final population: %ld\n", board_population(&board));
+    printf("Time Taken: %.3fs\n", elapsed);
+
+    board_free(&board);
+    return EXIT_SUCCESS;
+}
+
+// Allocate a board and fill it with a pattern in the middle or random cells
+void board_init(board_t *board, int size, double density, const char *pattern) {
+    board->size = size;
+    board->stride = size + 2;
+    size_t bytes = (size_t)board->stride * board->stride;
+    board->cells = calloc(bytes, 1);
+    board->next_cells = calloc(bytes, 1);
+    if (board->cells == NULL || board->next_cells == NULL) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const uint8_t *shape = NULL;
+    int height = 0, width = 0;
+    if (strcmp(pattern, "grower") == 0) {
+        shape = &grower[0][0], height = GROWER_HEIGHT, width = GROWER_WIDTH;
+    } else if (strcmp(pattern, "glider") == 0) {
+        shape = &glider[0][0], height = GLIDER_HEIGHT, width = GLIDER_WIDTH;
+    } else if (strcmp(pattern, "beehive") == 0) {
+        shape = &beehive[0][0], height = BEEHIVE_HEIGHT, width = BEEHIVE_WIDTH;
+    } else if (strcmp(pattern, "random") != 0) {
+        fprintf(stderr, "Unknown pattern '%s'.\n", pattern);
+        exit(EXIT_FAILURE);
+    }
+
+    if (shape != NULL) {
+        if (height > size || width > size) {
+            fprintf(stderr, "Pattern '%s' does not fit on a %dx%d board.\n", pattern, size, size);
+            exit(EXIT_FAILURE);
+        }
+        int offset_x = (size - height) / 2;
+        int offset_y = (size - width) / 2;
+        for (int i = 0; i < height; i++) {
+            for (int j = 0; j < width; j++) {
+                board->cells[(size_t)(offset_x + i + 1) * board->stride + offset_y + j + 1] = shape[i * width + j];
+            }
+        }
+    } else {
+        // Fixed seed so every candidate and every run sees the same board
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        uint64_t threshold = (uint64_t)(density * 4294967296.0);
+        for (int i = 1; i <= size; i++) {
+            for (int j = 1; j <= size; j++) {
+                state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                board->cells[(size_t)i * board->stride + j] = (state >> 32) < threshold;
+            }
+        }
+    }
+}
+
+// Free a board
+void board_free(board_t *board) {
+    free(board->cells);
+    free(board->next_cells);
+}
+
+// Advance the board one generation with the given configuration
+void board_step(board_t *board, config_t config) {
+    int size = board->size;
+    int stride = board->stride;
+    const uint8_t *src = board->cells;
+    uint8_t *dst = board->next_cells;
+    int kernel = config.kernel;
+
+    omp_set_schedule(schedules[config.schedule], 0);
+
+    int tile = tile_sizes[config.tile];
+    if (tile == 0) {
+        #pragma omp parallel for schedule(runtime) num_threads(config.threads)
+        for (int i = 1; i <= size; i++) {
+            step_tile(kernel, src, dst, stride, i, i + 1, 1, size + 1);
+        }
+    } else {
+        int tiles_per_side = (size + tile - 1) / tile;
+        #pragma omp parallel for schedule(runtime) num_threads(config.threads)
+        for (int t = 0; t < tiles_per_side * tiles_per_side; t++) {
+            int r0 = 1 + (t / tiles_per_side) * tile;
+            int c0 = 1 + (t % tiles_per_side) * tile;
+            int r1 = r0 + tile > size + 1 ? size + 1 : r0 + tile;
+            int c1 = c0 + tile > size + 1 ? size + 1 : c0 + tile;
+            step_tile(kernel, src, dst, stride, r0, r1, c0, c1);
+        }
+    }
+
+    board->cells = board->next_cells;
+    board->next_cells = (uint8_t *)src;
+}
+
+// Count alive cells
+long board_population(board_t *board) {
+    long population = 0;
+    #pragma omp parallel for reduction(+ : population)
+    for (int i = 1; i <= board->size; i++) {
+        for (int j = 1; j <= board->size; j++) {
+            population += board->cells[(size_t)i * board->stride + j];
+        }
+    }
+    return population;
+}
+
+// Apply the Game of Life rules to rows [r0, r1) and columns [c0, c1) of the padded board
+void step_tile(int kernel, const uint8_t *src, uint8_t *dst, int stride, int r0, int r1, int c0, int c1) {
+    switch (kernel) {
+    case KERNEL_LOOP:
+        // Straight port of count_neighbors() from the OpenMP engine
+        for (int i = r0; i < r1; i++) {
+            for (int j = c0; j < c1; j++) {
+                int neighbors = 0;
+                for (int x = -1; x <= 1; x++) {
+                    for (int y = -1; y <= 1; y++) {
+                        if (x == 0 && y == 0) continue;
+                        neighbors += src[(size_t)(i + x) * stride + j + y];
+                    }
+                }
+                uint8_t alive = src[(size_t)i * stride + j];
+                dst[(size_t)i * stride + j] = (neighbors == 3) || (alive && neighbors == 2);
+            }
+        }
+        break;
+
+    case KERNEL_UNROLLED:
+        // Branch-free sum of the eight neighbours, vectorisable across j
+        for (int i = r0; i < r1; i++) {
+            const uint8_t *up = src + (size_t)(i - 1) * stride;
+            const uint8_t *row = src + (size_t)i * stride;
+            const uint8_t *down = src + (size_t)(i + 1) * stride;
+            uint8_t *out = dst + (size_t)i * stride;
+            #pragma omp simd
+            for (int j = c0; j < c1; j++) {
+                uint8_t neighbors = up[j - 1] + up[j] + up[j + 1] +
+                                    row[j - 1] + row[j + 1] +
+                                    down[j - 1] + down[j] + down[j + 1];
+                out[j] = (neighbors == 3) | (row[j] & (neighbors == 2));
+            }
+        }
+        break;
+
+    default:
+        // Vertical sums of three cells are computed once and shared by the
+        // three horizontal windows that use them
+        for (int i = r0; i < r1; i++) {
+            const uint8_t *up = src + (size_t)(i - 1) * stride;
+            const uint8_t *row = src + (size_t)i * stride;
+            const uint8_t *down = src + (size_t)(i + 1) * stride;
+            uint8_t *out = dst + (size_t)i * stride;
+            for (int chunk = c0; chunk < c1; chunk += COLSUM_CHUNK) {
+                int end = chunk + COLSUM_CHUNK > c1 ? c1 : chunk + COLSUM_CHUNK;
+                uint8_t sums[COLSUM_CHUNK + 2];
+                #pragma omp simd
+                for (int j = chunk - 1; j <= end; j++) {
+                    sums[j - chunk + 1] = up[j] + row[j] + down[j];
+                }
+                #pragma omp simd
+                for (int j = chunk; j < end; j++) {
+                    // Total includes the cell itself
+                    uint8_t total = sums[j - chunk] + sums[j - chunk + 1] + sums[j - chunk + 2];
+                    out[j] = (total == 3) | (row[j] & (total == 4));
+                }
+            }
+        }
+        break;
+    }
+}
+
+// Seconds per generation of a configuration, best of a few generations
+double benchmark(board_t *board, config_t config) {
+    board_step(board, config); // Warm up caches and the thread team
+    double best = 1e30;
+    for (int g = 0; g < BENCH_GENERATIONS; g++) {
+        double start = omp_get_wtime();
+        board_step(board, config);
+        double elapsed = omp_get_wtime() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+// Coordinate descent over thread count, kernel, tile size and schedule
+config_t autotune(board_t *board) {
+    int thread_candidates[MAX_CANDIDATES];
+    int num_thread_candidates = 0;
+    int max_threads = omp_get_max_threads();
+    for (int t = 1; t < max_threads && num_thread_candidates < MAX_CANDIDATES - 1; t *= 2) {
+        thread_candidates[num_thread_candidates++] = t;
+    }
+    thread_candidates[num_thread_candidates++] = max_threads;
+
+    config_t best = {KERNEL_LOOP, 0, 0, max_threads};
+    double best_time = benchmark(board, best);
+
+    for (int pass = 0; pass < TUNING_PASSES; pass++) {
+        int changed = 0;
+        for (int dim = 0; dim < 4; dim++) {
+            int count = dim == 0 ? num_thread_candidates : dim == 1 ? NUM_KERNELS : dim == 2 ? NUM_TILES : NUM_SCHEDULES;
+            for (int c = 0; c < count; c++) {
+                config_t candidate = best;
+                switch (dim) {
+                case 0: candidate.threads = thread_candidates[c]; break;
+                case 1: candidate.kernel = c; break;
+                case 2: candidate.tile = c; break;
+                default: candidate.schedule = c; break;
+                }
+                if (memcmp(&candidate, &best, sizeof(config_t)) == 0) {
+                    continue;
+                }
+
+                double seconds = benchmark(board, candidate);
+                if (seconds < best_time) {
+                    best = candidate;
+                    best_time = seconds;
+                    changed = 1;
+                }
+            }
+        }
+        printf("Pass %d: %.6fs per generation with ", pass + 1, best_time);
+        describe_config(best);
+        if (!changed) {
+            break;
+        }
+    }
+    return best;
+}
+
+// Find a stored configuration for this machine and problem shape
+int lookup_config(const char *db_path, const char *machine, int size, double density, const char *pattern, config_t *config) {
+    FILE *db = fopen(db_path, "r");
+    if (db == NULL) {
+        return 0;
+    }
+
+    // Later lines override earlier ones, so re-tuning simply appends
+    int found = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), db) != NULL) {
+        char db_machine[300], db_pattern[64], kernel[32], schedule[32];
+        int db_size, tile, threads;
+        double db_density, seconds;
+        if (sscanf(line, "%299s %d %lf %63s %31s %d %31s %d %lf", db_machine, &db_size, &db_density, db_pattern,
+                   kernel, &tile, schedule, &threads, &seconds) != 9) {
+            continue;
+        }
+        // Densities are stored with %.17g, which reads back as the same double
+        if (strcmp(db_machine, machine) != 0 || db_size != size || strcmp(db_pattern, pattern) != 0 ||
+            db_density != density) {
+            continue;
+        }
+
+        config_t candidate = {-1, -1, -1, threads};
+        for (int k = 0; k < NUM_KERNELS; k++) {
+            if (strcmp(kernel, kernel_names[k]) == 0) candidate.kernel = k;
+        }
+        for (int t = 0; t < NUM_TILES; t++) {
+            if (tile == tile_sizes[t]) candidate.tile = t;
+        }
+        for (int s = 0; s < NUM_SCHEDULES; s++) {
+            if (strcmp(schedule, schedule_names[s]) == 0) candidate.schedule = s;
+        }
+        if (candidate.kernel >= 0 && candidate.tile >= 0 && candidate.schedule >= 0 && threads > 0) {
+            *config = candidate;
+            found = 1;
+        }
+    }
+    fclose(db);
+    return found;
+}
+
+// Append the winning configuration to the tuning database
+void store_config(const char *db_path, const char *machine, int size, double density, const char *pattern, config_t config, double seconds) {
+    FILE *db = fopen(db_path, "a");
+    if (db == NULL) {
+        fprintf(stderr, "Warning: could not write tuning database %s.\n", db_path);
+        return;
+    }
+    fprintf(db, "%s %d %.17g %s %s %d %s %d %.9f\n", machine, size, density, pattern, kernel_names[config.kernel],
+            tile_sizes[config.tile], schedule_names[config.schedule], config.threads, seconds);
+    fclose(db);
+}
+
+// Print a configuration
+void describe_config(config_t config) {
+    printf("kernel=%s tile=%d schedule=%s threads=%d\n", kernel_names[config.kernel], tile_sizes[config.tile],
+           schedule_names[config.schedule], config.threads);
+}
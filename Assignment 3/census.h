@@ -0,0 +1,416 @@
+/* File: census.h */
+
+// Object census of a Game of Life board.
+//
+// Live cells are grouped into objects with a union-find labelling pass. Two
+// cells at most CENSUS_REACH apart (in both directions) can give birth to a
+// cell together, so they belong to the same object; plain 8-connectivity
+// would split e.g. a lightweight spaceship in two. Every object is then
+// classified by evolving it alone on a small scratch board for up to
+// CENSUS_MAX_PERIOD generations: it is a still life if it comes back
+// unchanged after one generation, an oscillator if it comes back in place
+// later, and a glider (five cells, period four) or another spaceship if it
+// comes back shifted. Everything else, including objects that die or grow,
+// counts as other.
+//
+// The labelling is tiled over the OpenMP threads in bands of rows. Each
+// thread unions the cells of its own band, where path compression never
+// leaves the band, then one thread merges the rows on either side of every
+// band boundary. Object numbers come from a prefix sum over the roots per
+// band, so the objects rooted in a band form one range of numbers and the
+// thread of that band owns their bounding boxes. Parts of objects rooted in
+// an earlier band are collected in a small table per thread and merged
+// afterwards; such an object has a cell in the first CENSUS_REACH rows of
+// the band, so the tables hold at most CENSUS_REACH * cols entries each and
+// memory stays linear in the number of objects whatever the thread count.
+//
+// The objects are classified in parallel. Each thread reuses its scratch
+// boards, and a generation is only computed around the live cells of the
+// previous one, so a small object costs about its own size per generation
+// rather than that of the whole scratch board.
+
+#ifndef CENSUS_H
+#define CENSUS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+// The pragmas go through CENSUS_OMP so that programs built without -fopenmp,
+// such as the MPI engines, get no unknown-pragma warnings
+#ifdef _OPENMP
+#include <omp.h>
+#define CENSUS_OMP(directive) _Pragma(#directive)
+#else
+#define CENSUS_OMP(directive)
+#define omp_get_max_threads() 1
+#define omp_get_num_threads() 1
+#define omp_get_thread_num() 0
+#endif
+
+#define CENSUS_MAX_PERIOD 15
+#define CENSUS_MAX_CELLS 4096  // Larger components are not evolved
+#define CENSUS_REACH 2         // Cells this close belong to the same object
+
+typedef enum {
+    CENSUS_STILL_LIFE,
+    CENSUS_OSCILLATOR,
+    CENSUS_GLIDER,
+    CENSUS_SPACESHIP,
+    CENSUS_OTHER,
+    CENSUS_NUM_CLASSES
+} census_class_t;
+
+static const char *census_class_names[CENSUS_NUM_CLASSES] = {"still life", "oscillator", "glider", "spaceship", "other"};
+
+typedef struct {
+    long objects;
+    long counts[CENSUS_NUM_CLASSES]; // Objects per class
+    long cells[CENSUS_NUM_CLASSES];  // Live cells per class
+} census_t;
+
+// Bounding box and size of one component
+typedef struct {
+    int top, left, bottom, right;
+    int cells;
+} census_box_t;
+
+// Part of an object rooted in another band; label -1 marks a free slot
+typedef struct {
+    int label;
+    census_box_t box;
+} census_part_t;
+
+// Scratch boards of one thread, reused between objects
+typedef struct {
+    uint8_t *cells;
+    size_t size;
+} census_scratch_t;
+
+// Root of a cell, halving the path on the way
+static inline int census_find(int *parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+// Root of a cell without modifying the forest
+static inline int census_root(const int *parent, int i) {
+    while (parent[i] != i) {
+        i = parent[i];
+    }
+    return i;
+}
+
+// Join two components, keeping the smaller index as the root
+static inline void census_union(int *parent, int a, int b) {
+    a = census_find(parent, a);
+    b = census_find(parent, b);
+    if (a < b) {
+        parent[b] = a;
+    } else if (b < a) {
+        parent[a] = b;
+    }
+}
+
+// Join a live cell with the live cells up to CENSUS_REACH rows above it that
+// lie in rows [from, to)
+static inline void census_link_above(int *parent, int cols, int i, int j, int from, int to) {
+    for (int r = i - CENSUS_REACH; r < i; r++) {
+        if (r < from || r >= to) {
+            continue;
+        }
+        for (int c = j - CENSUS_REACH; c <= j + CENSUS_REACH; c++) {
+            if (c >= 0 && c < cols && parent[r * cols + c] >= 0) {
+                census_union(parent, i * cols + j, r * cols + c);
+            }
+        }
+    }
+}
+
+// Grow box to include cell (i, j)
+static inline void census_extend(census_box_t *box, int i, int j, int cells) {
+    box->top = i < box->top ? i : box->top;
+    box->bottom = i > box->bottom ? i : box->bottom;
+    box->left = j < box->left ? j : box->left;
+    box->right = j > box->right ? j : box->right;
+    box->cells += cells;
+}
+
+// Bounding box of the live cells of a scratch board within rows [top,
+// bottom] and columns [left, right]; returns the live count
+static inline int census_bounds(const uint8_t *board, int width, int top, int left, int bottom, int right, census_box_t *box) {
+    *box = (census_box_t){INT_MAX, INT_MAX, -1, -1, 0};
+    for (int i = top; i <= bottom; i++) {
+        for (int j = left; j <= right; j++) {
+            if (board[i * width + j]) {
+                census_extend(box, i, j, 1);
+            }
+        }
+    }
+    return box->cells;
+}
+
+// Classify one component by evolving it alone. Live cells spread by at most
+// one cell per generation, so the next generation is only computed one cell
+// around the current bounding box, and the margin keeps that off the edge.
+static inline census_class_t census_classify(const int *labels, int cols, int label, const census_box_t *box,
+                                             census_scratch_t *scratch) {
+    if (box->cells > CENSUS_MAX_CELLS) {
+        return CENSUS_OTHER;
+    }
+    const int margin = CENSUS_MAX_PERIOD + 2;
+    const int box_height = box->bottom - box->top + 1, box_width = box->right - box->left + 1;
+    const int height = box_height + 2 * margin, width = box_width + 2 * margin;
+    const size_t board = (size_t)height * width;
+    if (scratch->size < 3 * board) {
+        uint8_t *cells = realloc(scratch->cells, 3 * board);
+        if (cells == NULL) {
+            return CENSUS_OTHER;
+        }
+        scratch->cells = cells;
+        scratch->size = 3 * board;
+    }
+    uint8_t *initial = scratch->cells, *current = initial + board, *next = current + board;
+    memset(scratch->cells, 0, 3 * board);
+
+    for (int i = 0; i < box_height; i++) {
+        for (int j = 0; j < box_width; j++) {
+            initial[(i + margin) * width + j + margin] = labels[(long)(box->top + i) * cols + box->left + j] == label;
+        }
+    }
+    memcpy(current, initial, board);
+
+    // Bounding boxes of the live cells in current and next
+    census_box_t live = {margin, margin, margin + box_height - 1, margin + box_width - 1, box->cells};
+    census_box_t stale = {0, 0, -1, -1, 0};
+
+    census_class_t result = CENSUS_OTHER;
+    for (int generation = 1; generation <= CENSUS_MAX_PERIOD; generation++) {
+        for (int i = stale.top; i <= stale.bottom; i++) {
+            memset(next + i * width + stale.left, 0, stale.right - stale.left + 1);
+        }
+        for (int i = live.top - 1; i <= live.bottom + 1; i++) {
+            const uint8_t *up = current + (i - 1) * width, *row = current + i * width, *down = current + (i + 1) * width;
+            for (int j = live.left - 1; j <= live.right + 1; j++) {
+                int neighbors = up[j - 1] + up[j] + up[j + 1] + row[j - 1] + row[j + 1] + down[j - 1] + down[j] + down[j + 1];
+                next[i * width + j] = (neighbors == 3) | (row[j] & (neighbors == 2));
+            }
+        }
+        uint8_t *temp = current;
+        current = next;
+        next = temp;
+
+        census_box_t now;
+        if (census_bounds(current, width, live.top - 1, live.left - 1, live.bottom + 1, live.right + 1, &now) == 0) {
+            break;
+        }
+        stale = live;
+        live = now;
+        if (now.cells != box->cells || now.bottom - now.top + 1 != box_height || now.right - now.left + 1 != box_width) {
+            continue;
+        }
+
+        int same = 1;
+        for (int i = 0; i < box_height && same; i++) {
+            same = memcmp(current + (now.top + i) * width + now.left, initial + (margin + i) * width + margin, box_width) == 0;
+        }
+        if (!same) {
+            continue;
+        }
+
+        int moved = now.top != margin || now.left != margin;
+        if (!moved) {
+            result = generation == 1 ? CENSUS_STILL_LIFE : CENSUS_OSCILLATOR;
+        } else {
+            result = generation == 4 && box->cells == 5 ? CENSUS_GLIDER : CENSUS_SPACESHIP;
+        }
+        break;
+    }
+    return result;
+}
+
+// Count and classify the objects in the rows x cols region of grid starting
+// at (row0, col0). threads = 0 uses the OpenMP default. Returns -1 if the
+// region is too large or memory runs out.
+static inline int census_count(int **grid, int row0, int col0, int rows, int cols, int threads, census_t *result) {
+    memset(result, 0, sizeof(census_t));
+    if (rows < 1 || cols < 1) {
+        return 0;
+    }
+    if ((long)rows * cols >= INT_MAX) {
+        return -1;
+    }
+    const long cells = (long)rows * cols;
+    int *parent = malloc(cells * sizeof(int));
+    int *labels = malloc(cells * sizeof(int));
+    if (parent == NULL || labels == NULL) {
+        free(parent);
+        free(labels);
+        return -1;
+    }
+    if (threads < 1) {
+        threads = omp_get_max_threads();
+    }
+    threads = threads > rows / CENSUS_REACH ? rows / CENSUS_REACH : threads;
+    threads = threads < 1 ? 1 : threads;
+
+    // Table of object parts rooted in earlier bands, per thread
+    int capacity = 1;
+    while (capacity < 2 * CENSUS_REACH * cols) {
+        capacity *= 2;
+    }
+    long *band_roots = calloc(threads + 1, sizeof(long));
+    census_part_t *parts = malloc((size_t)threads * capacity * sizeof(census_part_t));
+    if (band_roots == NULL || parts == NULL) {
+        free(band_roots);
+        free(parts);
+        free(parent);
+        free(labels);
+        return -1;
+    }
+    census_box_t *boxes = NULL;
+    int num_components = 0, failed = 0;
+
+    CENSUS_OMP(omp parallel num_threads(threads))
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        int first = (int)((long)rows * t / nt), last = (int)((long)rows * (t + 1) / nt);
+
+        // Union the cells of this band with their already visited neighbours
+        for (int i = first; i < last; i++) {
+            for (int j = 0; j < cols; j++) {
+                int index = i * cols + j;
+                if (!grid[row0 + i][col0 + j]) {
+                    parent[index] = -1;
+                    continue;
+                }
+                parent[index] = index;
+                for (int dj = -CENSUS_REACH; dj < 0; dj++) {
+                    if (j + dj >= 0 && parent[index + dj] >= 0) {
+                        census_union(parent, index, index + dj);
+                    }
+                }
+                census_link_above(parent, cols, i, j, first, i);
+            }
+        }
+        CENSUS_OMP(omp barrier)
+
+        // Merge across the band boundaries
+        CENSUS_OMP(omp single)
+        for (int b = 1; b < nt; b++) {
+            int boundary = (int)((long)rows * b / nt);
+            for (int i = boundary; i < boundary + CENSUS_REACH && i < rows; i++) {
+                for (int j = 0; j < cols; j++) {
+                    if (parent[i * cols + j] >= 0) {
+                        census_link_above(parent, cols, i, j, 0, boundary);
+                    }
+                }
+            }
+        }
+
+        // Number the roots band by band
+        long roots = 0;
+        for (long index = (long)first * cols; index < (long)last * cols; index++) {
+            roots += parent[index] == index;
+        }
+        band_roots[t + 1] = roots;
+        CENSUS_OMP(omp barrier)
+        CENSUS_OMP(omp single)
+        {
+            for (int b = 1; b <= nt; b++) {
+                band_roots[b] += band_roots[b - 1];
+            }
+            num_components = (int)band_roots[nt];
+            boxes = malloc((num_components > 0 ? num_components : 1) * sizeof(census_box_t));
+            failed = boxes == NULL;
+        }
+
+        long next_label = band_roots[t];
+        for (long index = (long)first * cols; index < (long)last * cols; index++) {
+            labels[index] = parent[index] == index ? (int)next_label++ : -1;
+        }
+        CENSUS_OMP(omp barrier)
+        for (long index = (long)first * cols; index < (long)last * cols; index++) {
+            if (parent[index] >= 0 && parent[index] != index) {
+                labels[index] = labels[census_root(parent, (int)index)];
+            }
+        }
+
+        // Bounding boxes of the objects rooted in this band, and parts of the
+        // objects rooted above it
+        census_part_t *table = parts + (size_t)t * capacity;
+        for (int slot = 0; slot < capacity; slot++) {
+            table[slot].label = -1;
+        }
+        if (!failed) {
+            const int own_first = (int)band_roots[t], own_last = (int)band_roots[t + 1];
+            for (int c = own_first; c < own_last; c++) {
+                boxes[c] = (census_box_t){INT_MAX, INT_MAX, -1, -1, 0};
+            }
+            for (int i = first; i < last; i++) {
+                for (int j = 0; j < cols; j++) {
+                    int label = labels[i * cols + j];
+                    if (label < 0) {
+                        continue;
+                    }
+                    if (label >= own_first) {
+                        census_extend(&boxes[label], i, j, 1);
+                        continue;
+                    }
+                    int slot = (int)(((unsigned)label * 2654435761u) & (capacity - 1));
+                    while (table[slot].label >= 0 && table[slot].label != label) {
+                        slot = (slot + 1) & (capacity - 1);
+                    }
+                    if (table[slot].label < 0) {
+                        table[slot].label = label;
+                        table[slot].box = (census_box_t){INT_MAX, INT_MAX, -1, -1, 0};
+                    }
+                    census_extend(&table[slot].box, i, j, 1);
+                }
+            }
+        }
+        CENSUS_OMP(omp barrier)
+
+        // Merge the parts into their owners' boxes
+        CENSUS_OMP(omp single)
+        for (size_t slot = 0; !failed && slot < (size_t)nt * capacity; slot++) {
+            if (parts[slot].label >= 0) {
+                const census_box_t *part = &parts[slot].box;
+                census_box_t *box = &boxes[parts[slot].label];
+                census_extend(box, part->top, part->left, part->cells);
+                census_extend(box, part->bottom, part->right, 0);
+            }
+        }
+
+        // Classify the components
+        long counts[CENSUS_NUM_CLASSES] = {0}, live[CENSUS_NUM_CLASSES] = {0};
+        if (!failed) {
+            census_scratch_t scratch = {NULL, 0};
+            CENSUS_OMP(omp for schedule(dynamic, 64))
+            for (int c = 0; c < num_components; c++) {
+                census_class_t kind = census_classify(labels, cols, c, &boxes[c], &scratch);
+                counts[kind]++;
+                live[kind] += boxes[c].cells;
+            }
+            free(scratch.cells);
+        }
+        CENSUS_OMP(omp critical)
+        for (int k = 0; k < CENSUS_NUM_CLASSES; k++) {
+            result->counts[k] += counts[k];
+            result->cells[k] += live[k];
+        }
+    }
+
+    result->objects = failed ? 0 : num_components;
+    free(boxes);
+    free(parts);
+    free(band_roots);
+    free(parent);
+    free(labels);
+    return failed ? -1 : 0;
+}
+
+#endif
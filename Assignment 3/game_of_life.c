@@ -1,11 +1,25 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
 #include "glider.h"  // Include the glider pattern header file
+#include "snapshot.h"
 
 #define ROWS 3002
 #define COLS 3002
 #define GENERATIONS 5000
+#define MONITOR_INTERVAL_MS 1000
+#define MONITOR_ROW 1500
+#define MONITOR_COL 1500
+#define MONITOR_SIZE 10
+
+// State shared with the monitor thread
+typedef struct {
+    snapshot_t *snapshot;
+    atomic_int running;
+} monitor_t;
 
 // Function prototypes
 void initialize_grid(int **grid);
@@ -14,6 +28,7 @@ void simulate(int **grid, int **next_grid);
 int count_alive_neighbors(int **grid, int row, int col);
 void free_grid(int **grid);
 void print_small_grid(int **grid, int rows, int cols);
+void *monitor_run(void *arg);
 
 int main() {
     // Allocate memory for the grids
@@ -34,21 +49,32 @@ int main() {
     printf("Initial Grid (center region):\n");
     print_small_grid(grid, 10, 10);
 
+    // Watch the center region from a separate thread while the simulation runs
+    snapshot_t snapshot;
+    snapshot_init(&snapshot, grid, next_grid, ROWS, COLS);
+    monitor_t monitor = {.snapshot = &snapshot};
+    atomic_init(&monitor.running, 1);
+    pthread_t monitor_thread;
+    int monitoring = pthread_create(&monitor_thread, NULL, monitor_run, &monitor) == 0;
+
     // Simulate the Game of Life for a set number of generations
     for (int generation = 1; generation <= GENERATIONS; generation++) {
+        snapshot_begin(&snapshot, generation);
         simulate(grid, next_grid);
 
         // Swap the grids
         int **temp = grid;
         grid = next_grid;
         next_grid = temp;
+        snapshot_publish(&snapshot, generation);
+    }
 
-        // Print progress for debugging
-        if (generation % 1000 == 0) {
-            printf("Generation %d (center region):\n", generation);
-            print_small_grid(grid, 10, 10);
-        }
+    atomic_store(&monitor.running, 0);
+    if (monitoring) {
+        pthread_join(monitor_thread, NULL);
     }
+    printf("Generation %d (center region):\n", GENERATIONS);
+    print_small_grid(grid, 10, 10);
 
     // Free allocated memory
     free_grid(grid);
@@ -132,3 +158,31 @@ void print_small_grid(int **grid, int rows, int cols) {
     }
     printf("\n");
 }
+
+// Print a snapshot of the center region every MONITOR_INTERVAL_MS without stopping the simulation.
+// The final generation is left to main, and a generation is never printed twice.
+void *monitor_run(void *arg) {
+    monitor_t *monitor = arg;
+    uint8_t region[MONITOR_SIZE * MONITOR_SIZE];
+    struct timespec interval = {MONITOR_INTERVAL_MS / 1000, (MONITOR_INTERVAL_MS % 1000) * 1000000L};
+    long last = -1;
+
+    while (atomic_load(&monitor->running)) {
+        nanosleep(&interval, NULL);
+        long generation = snapshot_read(monitor->snapshot, MONITOR_ROW, MONITOR_COL, MONITOR_SIZE, MONITOR_SIZE, region);
+        if (generation < 0 || generation == last || generation >= GENERATIONS) {
+            continue;
+        }
+        last = generation;
+        printf("Generation %ld (center region):\n", generation);
+        for (int i = 0; i < MONITOR_SIZE; i++) {
+            for (int j = 0; j < MONITOR_SIZE; j++) {
+                printf("%c ", region[i * MONITOR_SIZE + j] ? 'O' : '.');
+            }
+            printf("\n");
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    return NULL;
+}
@@ -0,0 +1,151 @@
+"""numpy interface to libgol (libgol.h).
+
+    from gol import Game
+    game = Game(3000, 3000)
+    game.load('grower', 1500, 1500)
+    game.step(5000)
+    print(game.generation, game.population)
+    board = game.board          # zero-copy view of the current generation
+    heat = game.pyramid(1)      # live cells per 64x64 tile
+
+game.board is a read-only numpy view straight into the engine's buffer, so
+reading it costs nothing, but it belongs to the generation it was taken at:
+the engine writes into the other buffer on the next step and back into this
+one on the step after, so take a new view after stepping. The view keeps the
+Game alive. It is read-only because writing cells directly would bypass the
+density pyramid; use load() to change the board. game.view() returns a
+consistent copy of a region and may be called from another thread while
+step() runs; ctypes releases the GIL during the call.
+"""
+
+import ctypes
+import os
+import subprocess
+
+import numpy as np
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SOURCES = [os.path.join(HERE, name) for name in ('libgol.c', 'libgol.h', 'snapshot.h', 'census.h')]
+LIBRARY = os.path.join(HERE, 'libgol.so')
+
+
+def _load():
+    # Build the library on first use, or again when its sources have changed
+    if not os.path.exists(LIBRARY) or os.path.getmtime(LIBRARY) < max(map(os.path.getmtime, SOURCES)):
+        subprocess.check_call(['gcc', '-O3', '-march=native', '-fopenmp', '-shared', '-fPIC',
+                               SOURCES[0], '-o', LIBRARY], cwd=HERE)
+    library = ctypes.CDLL(LIBRARY)
+    handle = ctypes.c_void_p
+    signatures = {
+        'gol_create': (handle, [ctypes.c_int, ctypes.c_int]),
+        'gol_destroy': (None, [handle]),
+        'gol_rows': (ctypes.c_int, [handle]),
+        'gol_cols': (ctypes.c_int, [handle]),
+        'gol_clear': (None, [handle]),
+        'gol_load_pattern': (ctypes.c_int, [handle, ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                            ctypes.c_int]),
+        'gol_load_named': (ctypes.c_int, [handle, ctypes.c_char_p, ctypes.c_int, ctypes.c_int]),
+        'gol_set_threads': (None, [handle, ctypes.c_int]),
+        'gol_step': (ctypes.c_long, [handle, ctypes.c_long]),
+        'gol_generation': (ctypes.c_long, [handle]),
+        'gol_population': (ctypes.c_long, [handle]),
+        'gol_view': (ctypes.c_long, [handle, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                     ctypes.c_void_p]),
+        'gol_census': (ctypes.c_long, [handle, ctypes.c_void_p, ctypes.c_void_p]),
+        'gol_census_class_name': (ctypes.c_char_p, [ctypes.c_int]),
+        'gol_pyramid_tile': (ctypes.c_int, [ctypes.c_int]),
+        'gol_pyramid_size': (ctypes.c_int, [handle, ctypes.c_int, ctypes.POINTER(ctypes.c_int),
+                                            ctypes.POINTER(ctypes.c_int)]),
+        'gol_pyramid': (ctypes.c_long, [handle, ctypes.c_int, ctypes.c_void_p]),
+        'gol_data': (ctypes.POINTER(ctypes.c_int), [handle]),
+        'gol_stride': (ctypes.c_int, [handle]),
+    }
+    for name, (restype, argtypes) in signatures.items():
+        function = getattr(library, name)
+        function.restype = restype
+        function.argtypes = argtypes
+    return library
+
+
+_library = _load()
+CENSUS_CLASSES = [_library.gol_census_class_name(k).decode() for k in range(5)]
+PYRAMID_TILES = [_library.gol_pyramid_tile(level) for level in range(3)]
+
+
+class Game:
+    def __init__(self, rows, cols, threads=0):
+        self._handle = _library.gol_create(rows, cols)
+        if not self._handle:
+            raise MemoryError(f'could not create a {rows}x{cols} board')
+        self.rows = rows
+        self.cols = cols
+        if threads:
+            _library.gol_set_threads(self._handle, threads)
+
+    def __del__(self):
+        if getattr(self, '_handle', None):
+            _library.gol_destroy(self._handle)
+            self._handle = None
+
+    def clear(self):
+        _library.gol_clear(self._handle)
+
+    def load(self, pattern, row, col):
+        """Place a named built-in pattern or a 2-D array (non-zero = alive) at (row, col)."""
+        if isinstance(pattern, str):
+            count = _library.gol_load_named(self._handle, pattern.encode(), row, col)
+            if count < 0:
+                raise ValueError(f'unknown pattern {pattern!r}')
+            return count
+        cells = np.ascontiguousarray(pattern, dtype=np.uint8)
+        if cells.ndim != 2:
+            raise ValueError('pattern must be 2-D')
+        return _library.gol_load_pattern(self._handle, cells.ctypes.data, cells.shape[0], cells.shape[1], row, col)
+
+    def step(self, n=1):
+        return _library.gol_step(self._handle, n)
+
+    @property
+    def generation(self):
+        return _library.gol_generation(self._handle)
+
+    @property
+    def population(self):
+        return _library.gol_population(self._handle)
+
+    @property
+    def board(self):
+        """Zero-copy, read-only rows x cols int32 view of the current generation."""
+        stride = _library.gol_stride(self._handle)
+        address = ctypes.addressof(_library.gol_data(self._handle).contents)
+        buffer = (ctypes.c_int * (self.rows * stride)).from_address(address)
+        buffer._game = self  # The array's base holds the buffer, which holds the engine
+        data = np.ctypeslib.as_array(buffer).reshape(self.rows, stride)[:, :self.cols]
+        data.flags.writeable = False
+        return data
+
+    def view(self, row=0, col=0, rows=None, cols=None):
+        """Consistent uint8 copy of a region, safe to call while another thread steps."""
+        rows = self.rows - row if rows is None else rows
+        cols = self.cols - col if cols is None else cols
+        out = np.empty((rows, cols), dtype=np.uint8)
+        if _library.gol_view(self._handle, row, col, rows, cols, out.ctypes.data) < 0:
+            raise ValueError('region outside the board')
+        return out
+
+    def census(self):
+        """Objects and live cells per class, e.g. {'glider': (3, 15), ...}."""
+        counts = np.zeros(len(CENSUS_CLASSES), dtype=np.int64)
+        cells = np.zeros(len(CENSUS_CLASSES), dtype=np.int64)
+        if _library.gol_census(self._handle, counts.ctypes.data, cells.ctypes.data) < 0:
+            raise MemoryError('census ran out of memory')
+        return {name: (int(counts[k]), int(cells[k])) for k, name in enumerate(CENSUS_CLASSES)}
+
+    def pyramid(self, level):
+        """Live cells per tile at a pyramid level (tiles of PYRAMID_TILES[level] cells square)."""
+        tile_rows, tile_cols = ctypes.c_int(), ctypes.c_int()
+        if _library.gol_pyramid_size(self._handle, level, ctypes.byref(tile_rows), ctypes.byref(tile_cols)) < 0:
+            raise ValueError(f'pyramid levels are 0 to {len(PYRAMID_TILES) - 1}')
+        out = np.empty((tile_rows.value, tile_cols.value), dtype=np.int32)
+        _library.gol_pyramid(self._handle, level, out.ctypes.data)
+        return out
@@ -0,0 +1,355 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <omp.h>
+#include "libgol.h"
+#include "snapshot.h"
+#include "census.h"
+#include "glider.h"
+#include "beehive.h"
+#include "grower.h"
+
+// Implementation of libgol.h
+//
+// One parallel region covers all generations of a gol_step() call, so the
+// threads are not forked again for every generation of a long run. Bands of
+// GOL_TILE rows are shared statically; each row is computed from the row
+// above, itself and the row below in a branch-free simd loop. The dead ring
+// around the board means no cell needs a bounds check.
+//
+// The density pyramid is kept up to date while stepping. A band covers
+// exactly one row of level 0 tiles, so while computing it a thread sums the
+// change of every column, then folds those into the change per tile. Level 0
+// counts of the band belong to the thread; only tiles whose count changed
+// touch the shared level 1 and 2 counts, with atomic adds.
+
+#define PARALLEL_CELLS (64 * 1024) // Smaller boards are stepped by one thread
+#define GOL_TILE 8                 // Level 0 tile size, each level is GOL_TILE times coarser
+
+_Static_assert(GOL_CENSUS_CLASSES == CENSUS_NUM_CLASSES, "libgol.h and census.h disagree on the census classes");
+
+struct gol {
+    int rows;
+    int cols;
+    int stride;        // cols + 2
+    int threads;
+    long generation;
+    int *cells[2];     // (rows + 2) x stride each, generation g in cells[g % 2]
+    int **row_ptrs[2]; // Row pointers into cells, for the snapshot protocol
+    snapshot_t snapshot;
+    int pyramid_rows[GOL_PYRAMID_LEVELS];
+    int pyramid_cols[GOL_PYRAMID_LEVELS];
+    int32_t *pyramid[GOL_PYRAMID_LEVELS]; // Live cells per tile, row-major
+    int pyramid_stale;                    // Set if a step could not track the tiles
+};
+
+// Function prototypes
+static void step_row(const int *up, const int *row, const int *down, int *out, int cols, int32_t *changes);
+static void pyramid_add(gol_t *gol, int tile_row, int tile_col, int32_t delta);
+static void pyramid_rebuild(gol_t *gol);
+
+// Create an empty board
+gol_t *gol_create(int rows, int cols) {
+    if (rows < 1 || cols < 1) {
+        return NULL;
+    }
+    gol_t *gol = calloc(1, sizeof(gol_t));
+    if (gol == NULL) {
+        return NULL;
+    }
+    gol->rows = rows;
+    gol->cols = cols;
+    gol->stride = cols + 2;
+
+    for (int b = 0; b < 2; b++) {
+        gol->cells[b] = calloc((size_t)(rows + 2) * gol->stride, sizeof(int));
+        gol->row_ptrs[b] = malloc((rows + 2) * sizeof(int *));
+        if (gol->cells[b] == NULL || gol->row_ptrs[b] == NULL) {
+            gol_destroy(gol);
+            return NULL;
+        }
+        for (int i = 0; i < rows + 2; i++) {
+            gol->row_ptrs[b][i] = gol->cells[b] + (size_t)i * gol->stride;
+        }
+    }
+    for (int level = 0; level < GOL_PYRAMID_LEVELS; level++) {
+        int tile = gol_pyramid_tile(level);
+        gol->pyramid_rows[level] = (rows + tile - 1) / tile;
+        gol->pyramid_cols[level] = (cols + tile - 1) / tile;
+        gol->pyramid[level] = calloc((size_t)gol->pyramid_rows[level] * gol->pyramid_cols[level], sizeof(int32_t));
+        if (gol->pyramid[level] == NULL) {
+            gol_destroy(gol);
+            return NULL;
+        }
+    }
+    snapshot_init(&gol->snapshot, gol->row_ptrs[0], gol->row_ptrs[1], rows + 2, gol->stride);
+    return gol;
+}
+
+// Free a board
+void gol_destroy(gol_t *gol) {
+    if (gol == NULL) {
+        return;
+    }
+    for (int b = 0; b < 2; b++) {
+        free(gol->cells[b]);
+        free(gol->row_ptrs[b]);
+    }
+    for (int level = 0; level < GOL_PYRAMID_LEVELS; level++) {
+        free(gol->pyramid[level]);
+    }
+    free(gol);
+}
+
+int gol_rows(const gol_t *gol) {
+    return gol->rows;
+}
+
+int gol_cols(const gol_t *gol) {
+    return gol->cols;
+}
+
+// Kill every cell and reset the generation counter
+void gol_clear(gol_t *gol) {
+    size_t cells = (size_t)(gol->rows + 2) * gol->stride;
+    memset(gol->cells[0], 0, cells * sizeof(int));
+    memset(gol->cells[1], 0, cells * sizeof(int));
+    for (int level = 0; level < GOL_PYRAMID_LEVELS; level++) {
+        memset(gol->pyramid[level], 0, (size_t)gol->pyramid_rows[level] * gol->pyramid_cols[level] * sizeof(int32_t));
+    }
+    gol->generation = 0;
+    snapshot_init(&gol->snapshot, gol->row_ptrs[0], gol->row_ptrs[1], gol->rows + 2, gol->stride);
+}
+
+// Copy a pattern into the current generation, clipped at the edges
+int gol_load_pattern(gol_t *gol, const uint8_t *cells, int pattern_rows, int pattern_cols, int row, int col) {
+    int **grid = gol->row_ptrs[gol->generation % 2];
+    int set = 0;
+    for (int i = 0; i < pattern_rows; i++) {
+        for (int j = 0; j < pattern_cols; j++) {
+            int r = row + i, c = col + j;
+            if (r < 0 || r >= gol->rows || c < 0 || c >= gol->cols) {
+                continue;
+            }
+            int alive = cells[(long)i * pattern_cols + j] != 0;
+            if (alive != grid[r + 1][c + 1]) {
+                pyramid_add(gol, r / GOL_TILE, c / GOL_TILE, alive - grid[r + 1][c + 1]);
+                grid[r + 1][c + 1] = alive;
+            }
+            set += alive;
+        }
+    }
+    return set;
+}
+
+// Load a built-in pattern
+int gol_load_named(gol_t *gol, const char *name, int row, int col) {
+    if (strcmp(name, "glider") == 0) {
+        return gol_load_pattern(gol, &glider[0][0], GLIDER_HEIGHT, GLIDER_WIDTH, row, col);
+    }
+    if (strcmp(name, "beehive") == 0) {
+        return gol_load_pattern(gol, &beehive[0][0], BEEHIVE_HEIGHT, BEEHIVE_WIDTH, row, col);
+    }
+    if (strcmp(name, "grower") == 0) {
+        return gol_load_pattern(gol, &grower[0][0], GROWER_HEIGHT, GROWER_WIDTH, row, col);
+    }
+    return -1;
+}
+
+void gol_set_threads(gol_t *gol, int threads) {
+    gol->threads = threads > 0 ? threads : 0;
+}
+
+// Advance n generations
+long gol_step(gol_t *gol, long n) {
+    int threads = gol->threads > 0 ? gol->threads : omp_get_max_threads();
+    if ((long)gol->rows * gol->cols < PARALLEL_CELLS) {
+        threads = 1;
+    }
+
+    const int bands = gol->pyramid_rows[0], tiles = gol->pyramid_cols[0], cols = gol->cols;
+
+    #pragma omp parallel num_threads(threads)
+    {
+        // Change per column over a band, indexed like the board columns
+        int32_t *changes = malloc((cols + 2) * sizeof(int32_t));
+        for (long s = 0; s < n; s++) {
+            #pragma omp single
+            snapshot_begin(&gol->snapshot, gol->generation + 1);
+
+            int **current = gol->row_ptrs[gol->generation % 2];
+            int **next = gol->row_ptrs[(gol->generation + 1) % 2];
+            #pragma omp for schedule(static)
+            for (int band = 0; band < bands; band++) {
+                int first = band * GOL_TILE + 1;
+                int last = first + GOL_TILE <= gol->rows + 1 ? first + GOL_TILE : gol->rows + 1;
+                if (changes != NULL) {
+                    memset(changes, 0, (cols + 2) * sizeof(int32_t));
+                }
+                for (int i = first; i < last; i++) {
+                    step_row(current[i - 1], current[i], current[i + 1], next[i], cols, changes);
+                }
+                for (int t = 0; changes != NULL && t < tiles; t++) {
+                    int32_t delta = 0;
+                    for (int j = t * GOL_TILE + 1; j <= (t + 1) * GOL_TILE && j <= cols; j++) {
+                        delta += changes[j];
+                    }
+                    if (delta != 0) {
+                        pyramid_add(gol, band, t, delta);
+                    }
+                }
+            }
+
+            #pragma omp single
+            {
+                gol->generation++;
+                snapshot_publish(&gol->snapshot, gol->generation);
+            }
+        }
+        if (changes == NULL) {
+            #pragma omp atomic write
+            gol->pyramid_stale = 1;
+        }
+        free(changes);
+    }
+    if (gol->pyramid_stale) {
+        pyramid_rebuild(gol);
+    }
+    return gol->generation;
+}
+
+long gol_generation(const gol_t *gol) {
+    return gol->generation;
+}
+
+// Number of live cells
+long gol_population(const gol_t *gol) {
+    int **grid = gol->row_ptrs[gol->generation % 2];
+    long population = 0;
+
+    #pragma omp parallel for reduction(+ : population) if ((long)gol->rows * gol->cols >= PARALLEL_CELLS)
+    for (int i = 1; i <= gol->rows; i++) {
+        for (int j = 1; j <= gol->cols; j++) {
+            population += grid[i][j];
+        }
+    }
+    return population;
+}
+
+// Copy a region of the latest published generation
+long gol_view(gol_t *gol, int row, int col, int rows, int cols, uint8_t *out) {
+    if (row < 0 || col < 0 || row + rows > gol->rows || col + cols > gol->cols) {
+        return -1;
+    }
+    return snapshot_read(&gol->snapshot, row + 1, col + 1, rows, cols, out);
+}
+
+// Object census of the current generation
+long gol_census(gol_t *gol, long *counts, long *cells) {
+    census_t census;
+    if (census_count(gol->row_ptrs[gol->generation % 2], 1, 1, gol->rows, gol->cols, gol->threads, &census) != 0) {
+        return -1;
+    }
+    for (int k = 0; k < CENSUS_NUM_CLASSES; k++) {
+        counts[k] = census.counts[k];
+        cells[k] = census.cells[k];
+    }
+    return census.objects;
+}
+
+const char *gol_census_class_name(int kind) {
+    return kind >= 0 && kind < CENSUS_NUM_CLASSES ? census_class_names[kind] : NULL;
+}
+
+// Tile size of a pyramid level
+int gol_pyramid_tile(int level) {
+    int tile = GOL_TILE;
+    for (int l = 0; l < level; l++) {
+        tile *= GOL_TILE;
+    }
+    return tile;
+}
+
+// Number of tile rows and columns of a pyramid level
+int gol_pyramid_size(const gol_t *gol, int level, int *tile_rows, int *tile_cols) {
+    if (level < 0 || level >= GOL_PYRAMID_LEVELS) {
+        return -1;
+    }
+    *tile_rows = gol->pyramid_rows[level];
+    *tile_cols = gol->pyramid_cols[level];
+    return 0;
+}
+
+// Copy the live-cell counts of a pyramid level
+long gol_pyramid(const gol_t *gol, int level, int32_t *out) {
+    if (level < 0 || level >= GOL_PYRAMID_LEVELS) {
+        return -1;
+    }
+    memcpy(out, gol->pyramid[level], (size_t)gol->pyramid_rows[level] * gol->pyramid_cols[level] * sizeof(int32_t));
+    return gol->generation;
+}
+
+int *gol_data(gol_t *gol) {
+    return gol->cells[gol->generation % 2] + gol->stride + 1;
+}
+
+int gol_stride(const gol_t *gol) {
+    return gol->stride;
+}
+
+// Compute one row of the next generation and, if changes is not NULL, add
+// the change of every cell to it. Cells 0 and cols + 1 are the dead ring.
+static void step_row(const int *up, const int *row, const int *down, int *out, int cols, int32_t *changes) {
+    if (changes == NULL) {
+        #pragma omp simd
+        for (int j = 1; j <= cols; j++) {
+            int neighbors = up[j - 1] + up[j] + up[j + 1] + row[j - 1] + row[j + 1] + down[j - 1] + down[j] + down[j + 1];
+            out[j] = (neighbors == 3) | (row[j] & (neighbors == 2));
+        }
+        return;
+    }
+    #pragma omp simd
+    for (int j = 1; j <= cols; j++) {
+        int neighbors = up[j - 1] + up[j] + up[j + 1] + row[j - 1] + row[j + 1] + down[j - 1] + down[j] + down[j + 1];
+        int alive = (neighbors == 3) | (row[j] & (neighbors == 2));
+        out[j] = alive;
+        changes[j] += alive - row[j];
+    }
+}
+
+// Add delta live cells to a level 0 tile and the tiles above it. Level 0
+// tiles belong to one thread while stepping; the coarser ones are shared.
+static void pyramid_add(gol_t *gol, int tile_row, int tile_col, int32_t delta) {
+    gol->pyramid[0][(long)tile_row * gol->pyramid_cols[0] + tile_col] += delta;
+    for (int level = 1; level < GOL_PYRAMID_LEVELS; level++) {
+        tile_row /= GOL_TILE;
+        tile_col /= GOL_TILE;
+        #pragma omp atomic
+        gol->pyramid[level][(long)tile_row * gol->pyramid_cols[level] + tile_col] += delta;
+    }
+}
+
+// Recount every tile from the board
+static void pyramid_rebuild(gol_t *gol) {
+    int **grid = gol->row_ptrs[gol->generation % 2];
+    for (int level = 0; level < GOL_PYRAMID_LEVELS; level++) {
+        memset(gol->pyramid[level], 0, (size_t)gol->pyramid_rows[level] * gol->pyramid_cols[level] * sizeof(int32_t));
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (int band = 0; band < gol->pyramid_rows[0]; band++) {
+        for (int t = 0; t < gol->pyramid_cols[0]; t++) {
+            int32_t count = 0;
+            for (int i = band * GOL_TILE; i < (band + 1) * GOL_TILE && i < gol->rows; i++) {
+                for (int j = t * GOL_TILE; j < (t + 1) * GOL_TILE && j < gol->cols; j++) {
+                    count += grid[i + 1][j + 1];
+                }
+            }
+            if (count != 0) {
+                pyramid_add(gol, band, t, count);
+            }
+        }
+    }
+    gol->pyramid_stale = 0;
+}
@@ -0,0 +1,83 @@
+/* File: libgol.h */
+
+// Embeddable Game of Life engine.
+//
+// Build: gcc -O3 -march=native -fopenmp -shared -fPIC libgol.c -o libgol.so
+// (gol.py does this itself the first time it is imported)
+//
+// A gol_t holds a rows x cols board surrounded by a ring of dead cells, in
+// two int buffers that are swapped every generation like in the standalone
+// engines. gol_data() points at cell (0, 0) of the current generation with
+// rows gol_stride() ints apart, so callers can read the board in place; the
+// pointer changes with every generation. gol_view() copies a region through
+// the snapshot protocol of snapshot.h and may be called from another thread
+// while gol_step() runs. Everything else must not overlap with gol_step().
+
+#ifndef LIBGOL_H
+#define LIBGOL_H
+
+#include <stdint.h>
+
+typedef struct gol gol_t;
+
+// Create an empty board; NULL if rows or cols is not positive or memory runs out
+gol_t *gol_create(int rows, int cols);
+
+// Free a board
+void gol_destroy(gol_t *gol);
+
+// Board size
+int gol_rows(const gol_t *gol);
+int gol_cols(const gol_t *gol);
+
+// Kill every cell and reset the generation counter
+void gol_clear(gol_t *gol);
+
+// Copy a row-major pattern (non-zero = alive) with its top left corner at
+// (row, col), clipping it at the board edges; returns the number of cells set
+int gol_load_pattern(gol_t *gol, const uint8_t *cells, int pattern_rows, int pattern_cols, int row, int col);
+
+// Load one of the built-in patterns "glider", "beehive" or "grower"; -1 if unknown
+int gol_load_named(gol_t *gol, const char *name, int row, int col);
+
+// Number of threads gol_step() uses (0 = OpenMP default)
+void gol_set_threads(gol_t *gol, int threads);
+
+// Advance n generations; returns the new generation number
+long gol_step(gol_t *gol, long n);
+
+// Current generation number
+long gol_generation(const gol_t *gol);
+
+// Number of live cells
+long gol_population(const gol_t *gol);
+
+// Copy a region of the latest generation as 0/1 bytes (rows x cols,
+// row-major); returns the generation copied, or -1 if the region is outside
+// the board
+long gol_view(gol_t *gol, int row, int col, int rows, int cols, uint8_t *out);
+
+// Object census of the current generation (see census.h). Objects and live
+// cells per class are stored in counts and cells, which need room for
+// GOL_CENSUS_CLASSES entries in the order of gol_census_class_name().
+// Returns the number of objects, or -1 if memory runs out.
+#define GOL_CENSUS_CLASSES 5
+long gol_census(gol_t *gol, long *counts, long *cells);
+const char *gol_census_class_name(int kind);
+
+// Density pyramid: live cells per 8x8, 64x64 and 512x512 tile (levels 0 to
+// 2), kept up to date by gol_step() from the tiles that changed. Tiles on
+// the bottom and right edges may be cut off by the board.
+#define GOL_PYRAMID_LEVELS 3
+int gol_pyramid_tile(int level);
+int gol_pyramid_size(const gol_t *gol, int level, int *tile_rows, int *tile_cols);
+
+// Copy the counts of a level (tile_rows x tile_cols, row-major) into out;
+// returns the generation they belong to or -1 for an unknown level
+long gol_pyramid(const gol_t *gol, int level, int32_t *out);
+
+// Cell (0, 0) of the current generation and the distance between rows in ints
+int *gol_data(gol_t *gol);
+int gol_stride(const gol_t *gol);
+
+#endif
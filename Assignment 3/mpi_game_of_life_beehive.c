@@ -3,17 +3,39 @@
 #include <stdint.h>
 #include <mpi.h>
 #include "beehive.h"
+#include "census.h"
 
 #define ROWS 20
 #define COLS 20
 #define GENERATIONS 10
+#define EXPECTED_STILL_LIFES 1
+#define BEEHIVE_CELLS 6
+
+// Both local grids of a rank live in its segment of a node-wide shared
+// window. Halo rows of neighbours on the same node point straight into the
+// neighbour's segment; only neighbours on other nodes exchange messages.
+// Those messages go through persistent requests set up once per grid, which
+// send from and receive into the halo rows themselves.
+typedef struct {
+    MPI_Win win;
+    MPI_Comm node_comm;
+    int node_size;
+    int top_shared;
+    int bottom_shared;
+    int **request_grid[2];
+    MPI_Request requests[2][4];
+    int num_requests;
+} halo_exchange_t;
 
 // Function prototypes
 int **allocate_grid(int rows, int cols);
 void free_grid(int **grid);
+void allocate_shared_grids(halo_exchange_t *exchange, int ***grid, int ***next_grid, int local_rows, int cols, int rank, int num_processes);
+void free_shared_grids(halo_exchange_t *exchange, int **grid, int **next_grid);
+void init_halo_requests(halo_exchange_t *exchange, int **grid, int **next_grid, int local_rows, int cols, int rank, int num_processes, MPI_Comm comm);
 void initialize_grid(int **grid, int rows, int cols);
 void load_pattern(int **grid, int start_row, int start_col, const uint8_t pattern[][BEEHIVE_WIDTH], int pattern_height, int pattern_width);
-void communicate_halos(int **local_grid, int local_rows, int cols, int rank, int num_processes, MPI_Comm comm);
+void communicate_halos(int **local_grid, halo_exchange_t *exchange);
 void simulate_local(int **local_grid, int **next_local_grid, int local_rows, int cols);
 int count_population(int **grid, int rows, int cols);
 void print_grid(int **grid, int rows, int cols);
@@ -43,8 +65,11 @@ int main(int argc, char **argv) {
         load_pattern(global_grid, 10, 10, beehive, BEEHIVE_HEIGHT, BEEHIVE_WIDTH);
     }
 
-    int **local_grid = allocate_grid(local_rows, COLS);
-    int **next_local_grid = allocate_grid(local_rows, COLS);
+    int **local_grid;
+    int **next_local_grid;
+    halo_exchange_t exchange;
+    allocate_shared_grids(&exchange, &local_grid, &next_local_grid, local_rows, COLS, rank, num_processes);
+    init_halo_requests(&exchange, local_grid, next_local_grid, local_rows, COLS, rank, num_processes, MPI_COMM_WORLD);
 
     // Scatter rows to processes (scatter internal rows only)
     MPI_Scatter(rank == 0 ? &global_grid[0][0] : NULL, internal_rows * COLS, MPI_INT,
@@ -52,7 +77,7 @@ int main(int argc, char **argv) {
 
     for (int gen = 0; gen < GENERATIONS; gen++) {
         // Communicate halos
-        communicate_halos(local_grid, local_rows, COLS, rank, num_processes, MPI_COMM_WORLD);
+        communicate_halos(local_grid, &exchange);
 
         // Simulate locally
         simulate_local(local_grid, next_local_grid, local_rows, COLS);
@@ -71,18 +96,17 @@ int main(int argc, char **argv) {
             printf("Generation %d:\n", gen);
             print_grid(global_grid, ROWS, COLS);
 
-            int beehive_population = 0;
-            for (int i = 10; i < 10 + BEEHIVE_HEIGHT; i++) {
-                for (int j = 10; j < 10 + BEEHIVE_WIDTH; j++) {
-                    if (i < ROWS && j < COLS) {
-                        beehive_population += global_grid[i][j];
-                    }
-                }
-            }
-            if (beehive_population != 6) {
-                fprintf(stderr, "Error: Beehive population mismatch in generation %d. Population: %d\n", gen, beehive_population);
+            // The board must hold exactly the beehives and nothing else
+            census_t census;
+            if (census_count(global_grid, 0, 0, ROWS, COLS, 0, &census) != 0) {
+                fprintf(stderr, "Error: Census failed in generation %d.\n", gen);
+            } else if (census.objects != EXPECTED_STILL_LIFES || census.counts[CENSUS_STILL_LIFE] != EXPECTED_STILL_LIFES ||
+                       census.cells[CENSUS_STILL_LIFE] != EXPECTED_STILL_LIFES * BEEHIVE_CELLS) {
+                fprintf(stderr, "Error: Census mismatch in generation %d: %ld objects, %ld still lifes with %ld cells.\n",
+                        gen, census.objects, census.counts[CENSUS_STILL_LIFE], census.cells[CENSUS_STILL_LIFE]);
             } else {
-                printf("Beehive population is correct (%d) in generation %d.\n", beehive_population, gen);
+                printf("Census is correct in generation %d: %ld %s with %ld cells.\n", gen,
+                       census.counts[CENSUS_STILL_LIFE], census_class_names[CENSUS_STILL_LIFE], census.cells[CENSUS_STILL_LIFE]);
             }
 
             fflush(stdout); // Ensure output is flushed
@@ -90,8 +114,7 @@ int main(int argc, char **argv) {
     }
 
     // Free memory
-    free_grid(local_grid);
-    free_grid(next_local_grid);
+    free_shared_grids(&exchange, local_grid, next_local_grid);
 
     if (rank == 0) {
         free_grid(global_grid);
@@ -117,6 +140,97 @@ void free_grid(int **grid) {
     free(grid);
 }
 
+// Allocate both local grids in a shared window and alias the halo rows of
+// neighbours that live on the same node
+void allocate_shared_grids(halo_exchange_t *exchange, int ***grid, int ***next_grid, int local_rows, int cols, int rank, int num_processes) {
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &exchange->node_comm);
+    MPI_Comm_size(exchange->node_comm, &exchange->node_size);
+
+    int *base;
+    MPI_Aint block_size = (MPI_Aint)2 * local_rows * cols * sizeof(int);
+    MPI_Win_allocate_shared(block_size, sizeof(int), MPI_INFO_NULL, exchange->node_comm, &base, &exchange->win);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, exchange->win);
+
+    *grid = malloc(local_rows * sizeof(int *));
+    *next_grid = malloc(local_rows * sizeof(int *));
+    for (int i = 0; i < local_rows; i++) {
+        (*grid)[i] = base + i * cols;
+        (*next_grid)[i] = base + (local_rows + i) * cols;
+    }
+    for (int i = 0; i < 2 * local_rows * cols; i++) {
+        base[i] = 0;
+    }
+
+    // Find out which neighbours share this node
+    MPI_Group world_group, node_group;
+    MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+    MPI_Comm_group(exchange->node_comm, &node_group);
+    int neighbours[2] = {rank - 1, rank + 1};
+    int node_ranks[2] = {MPI_UNDEFINED, MPI_UNDEFINED};
+    for (int k = 0; k < 2; k++) {
+        if (neighbours[k] >= 0 && neighbours[k] < num_processes) {
+            MPI_Group_translate_ranks(world_group, 1, &neighbours[k], node_group, &node_ranks[k]);
+        }
+    }
+    MPI_Group_free(&world_group);
+    MPI_Group_free(&node_group);
+
+    exchange->top_shared = node_ranks[0] != MPI_UNDEFINED;
+    exchange->bottom_shared = node_ranks[1] != MPI_UNDEFINED;
+
+    MPI_Aint size;
+    int disp_unit;
+    int *neighbour_base;
+    if (exchange->top_shared) {
+        // Our top halo is the last internal row of the rank above
+        MPI_Win_shared_query(exchange->win, node_ranks[0], &size, &disp_unit, &neighbour_base);
+        (*grid)[0] = neighbour_base + (local_rows - 2) * cols;
+        (*next_grid)[0] = neighbour_base + (2 * local_rows - 2) * cols;
+    }
+    if (exchange->bottom_shared) {
+        // Our bottom halo is the first internal row of the rank below
+        MPI_Win_shared_query(exchange->win, node_ranks[1], &size, &disp_unit, &neighbour_base);
+        (*grid)[local_rows - 1] = neighbour_base + cols;
+        (*next_grid)[local_rows - 1] = neighbour_base + (local_rows + 1) * cols;
+    }
+}
+
+// Set up the halo messages to neighbours on other nodes for both grids, so
+// every generation only has to start and complete them
+void init_halo_requests(halo_exchange_t *exchange, int **grid, int **next_grid, int local_rows, int cols, int rank, int num_processes, MPI_Comm comm) {
+    exchange->request_grid[0] = grid;
+    exchange->request_grid[1] = next_grid;
+    exchange->num_requests = 0;
+
+    for (int k = 0; k < 2; k++) {
+        int **g = exchange->request_grid[k];
+        int n = 0;
+        if (rank > 0 && !exchange->top_shared) { // Top neighbor on another node
+            MPI_Send_init(g[1], cols, MPI_INT, rank - 1, 0, comm, &exchange->requests[k][n++]);
+            MPI_Recv_init(g[0], cols, MPI_INT, rank - 1, 0, comm, &exchange->requests[k][n++]);
+        }
+        if (rank < num_processes - 1 && !exchange->bottom_shared) { // Bottom neighbor on another node
+            MPI_Send_init(g[local_rows - 2], cols, MPI_INT, rank + 1, 0, comm, &exchange->requests[k][n++]);
+            MPI_Recv_init(g[local_rows - 1], cols, MPI_INT, rank + 1, 0, comm, &exchange->requests[k][n++]);
+        }
+        exchange->num_requests = n;
+    }
+}
+
+// Free the persistent requests, the shared window and the row pointers into it
+void free_shared_grids(halo_exchange_t *exchange, int **grid, int **next_grid) {
+    for (int k = 0; k < 2; k++) {
+        for (int n = 0; n < exchange->num_requests; n++) {
+            MPI_Request_free(&exchange->requests[k][n]);
+        }
+    }
+    MPI_Win_unlock_all(exchange->win);
+    MPI_Win_free(&exchange->win);
+    MPI_Comm_free(&exchange->node_comm);
+    free(grid);
+    free(next_grid);
+}
+
 // Initialize a grid
 void initialize_grid(int **grid, int rows, int cols) {
     for (int i = 0; i < rows; i++) {
@@ -136,35 +250,22 @@ void load_pattern(int **grid, int start_row, int start_col, const uint8_t patter
 }
 
 // Communicate halos
-void communicate_halos(int **local_grid, int local_rows, int cols, int rank, int num_processes, MPI_Comm comm) {
-    MPI_Status status;
-
-    int *recv_top = malloc(cols * sizeof(int));
-    int *recv_bottom = malloc(cols * sizeof(int));
-
-    // Exchange halos
-    if (rank > 0) { // Top neighbor
-        MPI_Sendrecv(local_grid[1], cols, MPI_INT, rank - 1, 0,
-                     recv_top, cols, MPI_INT, rank - 1, 0, comm, &status);
-    }
-    if (rank < num_processes - 1) { // Bottom neighbor
-        MPI_Sendrecv(local_grid[local_rows - 2], cols, MPI_INT, rank + 1, 0,
-                     recv_bottom, cols, MPI_INT, rank + 1, 0, comm, &status);
+void communicate_halos(int **local_grid, halo_exchange_t *exchange) {
+    // Every rank on the node has finished the previous generation once the
+    // barrier is passed, so shared halo rows can be read without copying.
+    // All ranks of a node take part, whether or not their neighbours share it.
+    if (exchange->node_size > 1) {
+        MPI_Win_sync(exchange->win);
+        MPI_Barrier(exchange->node_comm);
+        MPI_Win_sync(exchange->win);
     }
 
-    if (rank > 0) {
-        for (int j = 0; j < cols; j++) {
-            local_grid[0][j] = recv_top[j];
-        }
+    // Exchange halos with neighbours on other nodes
+    if (exchange->num_requests > 0) {
+        int k = (local_grid == exchange->request_grid[0]) ? 0 : 1;
+        MPI_Startall(exchange->num_requests, exchange->requests[k]);
+        MPI_Waitall(exchange->num_requests, exchange->requests[k], MPI_STATUSES_IGNORE);
     }
-    if (rank < num_processes - 1) {
-        for (int j = 0; j < cols; j++) {
-            local_grid[local_rows - 1][j] = recv_bottom[j];
-        }
-    }
-
-    free(recv_top);
-    free(recv_bottom);
 }
 
 // Simulate one step locally
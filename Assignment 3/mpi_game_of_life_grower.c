@@ -2,15 +2,31 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <omp.h>
+#include <sched.h>
 #include "grower.h" // Include the provided grower.h
 
 #define GRID_SIZE 3000
 #define ITERATIONS 5000
+#define CACHE_LINE 64
+#define SPINS_BEFORE_YIELD 1024
+
+// Compile with -DPERSISTENT_REGION to run all iterations inside a single
+// parallel region. Every thread then owns a fixed band of rows and only waits
+// for the two neighbouring bands instead of a team-wide barrier.
+
+// Per-thread generation counter, padded to a full cache line so the owner's
+// updates do not invalidate the line its neighbours are spinning on
+typedef struct {
+    int generation;
+    char padding[CACHE_LINE - sizeof(int)];
+} progress_t;
 
 // Function prototypes
 void initialize_grid(uint8_t grid[GRID_SIZE][GRID_SIZE]);
 void copy_grid(uint8_t dest[GRID_SIZE][GRID_SIZE], uint8_t src[GRID_SIZE][GRID_SIZE]);
 int count_neighbors(uint8_t grid[GRID_SIZE][GRID_SIZE], int x, int y);
+void update_rows(uint8_t grid[GRID_SIZE][GRID_SIZE], uint8_t new_grid[GRID_SIZE][GRID_SIZE], int first_row, int last_row);
+void wait_for_generation(progress_t *progress, int generation);
 
 int main() {
     // Allocate the grids
@@ -25,6 +41,54 @@ int main() {
     // Initialize the grid using grower.h
     initialize_grid(grid);
 
+#ifdef PERSISTENT_REGION
+    // Grids swap roles every iteration instead of being copied back
+    uint8_t (*buffers[2])[GRID_SIZE] = {grid, new_grid};
+
+    // Never use more threads than rows, so every band has at least one row and
+    // a band's boundary rows are always owned by its direct neighbours
+    int num_threads = omp_get_max_threads();
+    if (num_threads > GRID_SIZE) {
+        num_threads = GRID_SIZE;
+    }
+
+    progress_t *progress = aligned_alloc(CACHE_LINE, num_threads * sizeof(progress_t));
+    if (progress == NULL) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return EXIT_FAILURE;
+    }
+    for (int t = 0; t < num_threads; t++) {
+        progress[t].generation = 0;
+    }
+
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int first_row = (int)((long)t * GRID_SIZE / nt);
+        int last_row = (int)((long)(t + 1) * GRID_SIZE / nt);
+
+        for (int iter = 0; iter < ITERATIONS; iter++) {
+            // Neighbours must have written the rows we read (iteration iter - 1)
+            // and finished reading the rows we are about to overwrite
+            if (t > 0) {
+                wait_for_generation(&progress[t - 1], iter);
+            }
+            if (t < nt - 1) {
+                wait_for_generation(&progress[t + 1], iter);
+            }
+
+            update_rows(buffers[iter % 2], buffers[(iter + 1) % 2], first_row, last_row);
+
+            // Publish our band for iteration iter + 1
+            #pragma omp atomic write seq_cst
+            progress[t].generation = iter + 1;
+        }
+    }
+
+    free(progress);
+    uint8_t (*current)[GRID_SIZE] = buffers[ITERATIONS % 2];
+#else
     for (int iter = 0; iter < ITERATIONS; iter++) {
         // Update the grid in parallel
         #pragma omp parallel for
@@ -58,13 +122,15 @@ int main() {
 
     //     printf("Iteration %d: Population = %d\n", iter + 1, total_population);
     }
+    uint8_t (*current)[GRID_SIZE] = grid;
+#endif
 
     // Final population
     int final_population = 0;
     #pragma omp parallel for reduction(+ : final_population)
     for (int i = 0; i < GRID_SIZE; i++) {
         for (int j = 0; j < GRID_SIZE; j++) {
-            final_population += grid[i][j];
+            final_population += current[i][j];
         }
     }
     printf("Final population: %d\n", final_population);
@@ -110,3 +176,35 @@ int count_neighbors(uint8_t grid[GRID_SIZE][GRID_SIZE], int x, int y) {
     }
     return count;
 }
+
+// Apply the Game of Life rules to rows [first_row, last_row)
+void update_rows(uint8_t grid[GRID_SIZE][GRID_SIZE], uint8_t new_grid[GRID_SIZE][GRID_SIZE], int first_row, int last_row) {
+    for (int i = first_row; i < last_row; i++) {
+        for (int j = 0; j < GRID_SIZE; j++) {
+            int neighbors = count_neighbors(grid, i, j);
+            if (grid[i][j] == 1) {
+                new_grid[i][j] = (neighbors == 2 || neighbors == 3) ? 1 : 0;
+            } else {
+                new_grid[i][j] = (neighbors == 3) ? 1 : 0;
+            }
+        }
+    }
+}
+
+// Spin until a neighbouring band has published the given generation, giving
+// the core away now and then in case the machine is oversubscribed
+void wait_for_generation(progress_t *progress, int generation) {
+    int seen;
+    int spins = 0;
+    for (;;) {
+        #pragma omp atomic read seq_cst
+        seen = progress->generation;
+        if (seen >= generation) {
+            break;
+        }
+        if (++spins == SPINS_BEFORE_YIELD) {
+            spins = 0;
+            sched_yield();
+        }
+    }
+}
@@ -0,0 +1,372 @@
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <omp.h>
+#include "grower.h"
+
+// Out-of-core Game of Life engine
+//
+// Usage: ooc_game_of_life <board file> <rows> <cols> [generations] [band rows]
+//
+// The board lives in a file of rows * cols bytes (one byte per cell, row
+// major) instead of in memory. If the file does not exist it is created
+// sparse with the grower in the middle. Each generation streams the board
+// through a sliding window of three row bands into a scratch file, with an
+// I/O thread reading ahead and writing behind while the current band is
+// computed, so memory use is a handful of bands regardless of board size.
+
+#define DEFAULT_GENERATIONS 5000
+#define DEFAULT_BAND_ROWS 256
+#define INPUT_SLOTS 4  // previous, current, next and one band of read-ahead
+#define OUTPUT_SLOTS 2 // one band being computed, one being written behind
+#define IO_QUEUE_SIZE 8
+
+// A single read or write handed to the I/O thread
+typedef struct {
+    int fd;
+    uint8_t *buffer;
+    size_t length;
+    off_t offset;
+    int is_write;
+    int done;
+} io_job_t;
+
+// Queue of jobs served in order by one background thread
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    io_job_t *queue[IO_QUEUE_SIZE];
+    int head;
+    int count;
+    int stop;
+} io_worker_t;
+
+// Function prototypes
+void *io_thread(void *arg);
+void io_start(io_worker_t *io);
+void io_stop(io_worker_t *io);
+void io_submit(io_worker_t *io, io_job_t *job, int fd, uint8_t *buffer, size_t length, off_t offset, int is_write);
+void io_wait(io_worker_t *io, io_job_t *job);
+int create_board(const char *path, long rows, long cols);
+long simulate_generation(io_worker_t *io, int src_fd, int dst_fd, long rows, long cols, long band_rows,
+                         uint8_t *input[INPUT_SLOTS], uint8_t *output[OUTPUT_SLOTS], const uint8_t *dead_row);
+long update_row(const uint8_t *up, const uint8_t *row, const uint8_t *down, uint8_t *out, long cols);
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <board file> <rows> <cols> [generations] [band rows]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *path = argv[1];
+    long rows = atol(argv[2]);
+    long cols = atol(argv[3]);
+    int generations = argc > 4 ? atoi(argv[4]) : DEFAULT_GENERATIONS;
+    long band_rows = argc > 5 ? atol(argv[5]) : DEFAULT_BAND_ROWS;
+    if (rows < 1 || cols < 1 || generations < 0 || band_rows < 1) {
+        fprintf(stderr, "Rows, cols and band rows must be positive.\n");
+        return EXIT_FAILURE;
+    }
+    if (band_rows > rows) {
+        band_rows = rows;
+    }
+
+    if (access(path, F_OK) != 0 && create_board(path, rows, cols) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    char scratch_path[4096];
+    snprintf(scratch_path, sizeof(scratch_path), "%s.next", path);
+
+    int fds[2];
+    fds[0] = open(path, O_RDWR);
+    fds[1] = open(scratch_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fds[0] < 0 || fds[1] < 0) {
+        fprintf(stderr, "Could not open board files: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    off_t board_bytes = (off_t)rows * cols;
+    off_t file_bytes = lseek(fds[0], 0, SEEK_END);
+    if (file_bytes != board_bytes) {
+        fprintf(stderr, "%s holds %lld bytes, expected %lld for a %ldx%ld board.\n", path,
+                (long long)file_bytes, (long long)board_bytes, rows, cols);
+        return EXIT_FAILURE;
+    }
+    if (ftruncate(fds[1], board_bytes) != 0) {
+        fprintf(stderr, "Could not size scratch file: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    // The only memory the engine needs: six bands and one dead row
+    uint8_t *input[INPUT_SLOTS];
+    uint8_t *output[OUTPUT_SLOTS];
+    int allocated = 1;
+    for (int s = 0; s < INPUT_SLOTS; s++) {
+        input[s] = malloc(band_rows * cols);
+        allocated &= input[s] != NULL;
+    }
+    for (int s = 0; s < OUTPUT_SLOTS; s++) {
+        output[s] = malloc(band_rows * cols);
+        allocated &= output[s] != NULL;
+    }
+    uint8_t *dead_row = calloc(cols, 1);
+    if (dead_row == NULL || !allocated) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return EXIT_FAILURE;
+    }
+
+    io_worker_t io;
+    io_start(&io);
+
+    long population = -1;
+    double start = omp_get_wtime();
+    for (int gen = 0; gen < generations; gen++) {
+        population = simulate_generation(&io, fds[gen % 2], fds[(gen + 1) % 2], rows, cols, band_rows, input, output, dead_row);
+    }
+    double elapsed = omp_get_wtime() - start;
+
+    io_stop(&io);
+    close(fds[0]);
+    close(fds[1]);
+
+    // After an odd number of generations the result is in the scratch file
+    if (generations % 2 == 1) {
+        if (rename(scratch_path, path) != 0) {
+            fprintf(stderr, "Could not move result into place: %s\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+    } else {
+        unlink(scratch_path);
+    }
+
+    if (population >= 0) {
+        printf("Final population: %ld\n", population);
+    }
+    printf("Time Taken: %.3fs (%.1f MB/s streamed)\n", elapsed,
+           elapsed > 0 ? 2.0 * generations * (double)board_bytes / elapsed / 1e6 : 0.0);
+
+    for (int s = 0; s < INPUT_SLOTS; s++) {
+        free(input[s]);
+    }
+    for (int s = 0; s < OUTPUT_SLOTS; s++) {
+        free(output[s]);
+    }
+    free(dead_row);
+    return EXIT_SUCCESS;
+}
+
+// Serve queued jobs until asked to stop
+void *io_thread(void *arg) {
+    io_worker_t *io = arg;
+    pthread_mutex_lock(&io->lock);
+    for (;;) {
+        while (io->count == 0 && !io->stop) {
+            pthread_cond_wait(&io->changed, &io->lock);
+        }
+        if (io->count == 0) {
+            break;
+        }
+        io_job_t *job = io->queue[io->head];
+        pthread_mutex_unlock(&io->lock);
+
+        // pread/pwrite may transfer less than asked for, keep going
+        size_t transferred = 0;
+        while (transferred < job->length) {
+            ssize_t n = job->is_write
+                ? pwrite(job->fd, job->buffer + transferred, job->length - transferred, job->offset + transferred)
+                : pread(job->fd, job->buffer + transferred, job->length - transferred, job->offset + transferred);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                fprintf(stderr, "I/O error at offset %lld: %s\n", (long long)(job->offset + transferred),
+                        n < 0 ? strerror(errno) : "unexpected end of file");
+                exit(EXIT_FAILURE);
+            }
+            transferred += n;
+        }
+
+        pthread_mutex_lock(&io->lock);
+        job->done = 1;
+        io->head = (io->head + 1) % IO_QUEUE_SIZE;
+        io->count--;
+        pthread_cond_broadcast(&io->changed);
+    }
+    pthread_mutex_unlock(&io->lock);
+    return NULL;
+}
+
+// Launch the I/O thread
+void io_start(io_worker_t *io) {
+    io->head = 0;
+    io->count = 0;
+    io->stop = 0;
+    pthread_mutex_init(&io->lock, NULL);
+    pthread_cond_init(&io->changed, NULL);
+    pthread_create(&io->thread, NULL, io_thread, io);
+}
+
+// Drain the queue and join the I/O thread
+void io_stop(io_worker_t *io) {
+    pthread_mutex_lock(&io->lock);
+    io->stop = 1;
+    pthread_cond_broadcast(&io->changed);
+    pthread_mutex_unlock(&io->lock);
+    pthread_join(io->thread, NULL);
+    pthread_mutex_destroy(&io->lock);
+    pthread_cond_destroy(&io->changed);
+}
+
+// Queue a read or write; returns without waiting for it
+void io_submit(io_worker_t *io, io_job_t *job, int fd, uint8_t *buffer, size_t length, off_t offset, int is_write) {
+    job->fd = fd;
+    job->buffer = buffer;
+    job->length = length;
+    job->offset = offset;
+    job->is_write = is_write;
+    job->done = 0;
+
+    pthread_mutex_lock(&io->lock);
+    while (io->count == IO_QUEUE_SIZE) {
+        pthread_cond_wait(&io->changed, &io->lock);
+    }
+    io->queue[(io->head + io->count) % IO_QUEUE_SIZE] = job;
+    io->count++;
+    pthread_cond_broadcast(&io->changed);
+    pthread_mutex_unlock(&io->lock);
+}
+
+// Block until a submitted job has completed
+void io_wait(io_worker_t *io, io_job_t *job) {
+    pthread_mutex_lock(&io->lock);
+    while (!job->done) {
+        pthread_cond_wait(&io->changed, &io->lock);
+    }
+    pthread_mutex_unlock(&io->lock);
+}
+
+// Create a sparse, all dead board file with the grower in the middle
+int create_board(const char *path, long rows, long cols) {
+    if (rows < GROWER_HEIGHT || cols < GROWER_WIDTH) {
+        fprintf(stderr, "The grower does not fit on a %ldx%ld board.\n", rows, cols);
+        return -1;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)rows * cols) != 0) {
+        fprintf(stderr, "Could not create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    long offset_x = (rows - GROWER_HEIGHT) / 2;
+    long offset_y = (cols - GROWER_WIDTH) / 2;
+    for (int i = 0; i < GROWER_HEIGHT; i++) {
+        off_t offset = (off_t)(offset_x + i) * cols + offset_y;
+        if (pwrite(fd, grower[i], GROWER_WIDTH, offset) != GROWER_WIDTH) {
+            fprintf(stderr, "Could not write pattern to %s: %s\n", path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+    close(fd);
+    return 0;
+}
+
+// Stream one generation from src_fd to dst_fd band by band and return the new population
+long simulate_generation(io_worker_t *io, int src_fd, int dst_fd, long rows, long cols, long band_rows,
+                         uint8_t *input[INPUT_SLOTS], uint8_t *output[OUTPUT_SLOTS], const uint8_t *dead_row) {
+    long num_bands = (rows + band_rows - 1) / band_rows;
+    io_job_t reads[INPUT_SLOTS];
+    io_job_t writes[OUTPUT_SLOTS];
+    int write_pending[OUTPUT_SLOTS] = {0};
+    long population = 0;
+
+    // Rows in band b
+    #define BAND_HEIGHT(b) ((b) == num_bands - 1 ? rows - (b) * band_rows : band_rows)
+
+    for (long b = 0; b < 2 && b < num_bands; b++) {
+        io_submit(io, &reads[b], src_fd, input[b], BAND_HEIGHT(b) * cols, (off_t)b * band_rows * cols, 0);
+    }
+
+    for (long b = 0; b < num_bands; b++) {
+        int slot = b % INPUT_SLOTS;
+        long height = BAND_HEIGHT(b);
+
+        // The window needs this band and the one below it in memory
+        io_wait(io, &reads[slot]);
+        if (b + 1 < num_bands) {
+            io_wait(io, &reads[(b + 1) % INPUT_SLOTS]);
+        }
+
+        // Read ahead into the slot of the band that just left the window
+        if (b + 2 < num_bands) {
+            int ahead = (b + 2) % INPUT_SLOTS;
+            io_submit(io, &reads[ahead], src_fd, input[ahead], BAND_HEIGHT(b + 2) * cols, (off_t)(b + 2) * band_rows * cols, 0);
+        }
+
+        // The output slot is free once its previous band has been written
+        int out_slot = b % OUTPUT_SLOTS;
+        if (write_pending[out_slot]) {
+            io_wait(io, &writes[out_slot]);
+        }
+
+        const uint8_t *band = input[slot];
+        const uint8_t *above = b > 0 ? input[(b - 1) % INPUT_SLOTS] + (band_rows - 1) * cols : dead_row;
+        const uint8_t *below = b + 1 < num_bands ? input[(b + 1) % INPUT_SLOTS] : dead_row;
+        uint8_t *out = output[out_slot];
+
+        long band_population = 0;
+        #pragma omp parallel for reduction(+ : band_population)
+        for (long i = 0; i < height; i++) {
+            const uint8_t *up = i > 0 ? band + (i - 1) * cols : above;
+            const uint8_t *down = i < height - 1 ? band + (i + 1) * cols : below;
+            band_population += update_row(up, band + i * cols, down, out + i * cols, cols);
+        }
+        population += band_population;
+
+        io_submit(io, &writes[out_slot], dst_fd, out, height * cols, (off_t)b * band_rows * cols, 1);
+        write_pending[out_slot] = 1;
+    }
+    #undef BAND_HEIGHT
+
+    for (int s = 0; s < OUTPUT_SLOTS; s++) {
+        if (write_pending[s]) {
+            io_wait(io, &writes[s]);
+        }
+    }
+    return population;
+}
+
+// Apply the Game of Life rules to one row, cells beyond the edges are dead
+long update_row(const uint8_t *up, const uint8_t *row, const uint8_t *down, uint8_t *out, long cols) {
+    long alive = 0;
+    if (cols == 1) {
+        uint8_t neighbors = up[0] + down[0];
+        out[0] = (neighbors == 3) | (row[0] & (neighbors == 2));
+        return out[0];
+    }
+
+    uint8_t first = up[0] + up[1] + row[1] + down[0] + down[1];
+    out[0] = (first == 3) | (row[0] & (first == 2));
+    alive += out[0];
+
+    #pragma omp simd reduction(+ : alive)
+    for (long j = 1; j < cols - 1; j++) {
+        uint8_t neighbors = up[j - 1] + up[j] + up[j + 1] +
+                            row[j - 1] + row[j + 1] +
+                            down[j - 1] + down[j] + down[j + 1];
+        out[j] = (neighbors == 3) | (row[j] & (neighbors == 2));
+        alive += out[j];
+    }
+
+    long last = cols - 1;
+    uint8_t final = up[last - 1] + up[last] + row[last - 1] + down[last - 1] + down[last];
+    out[last] = (final == 3) | (row[last] & (final == 2));
+    alive += out[last];
+    return alive;
+}
@@ -0,0 +1,128 @@
+/* File: snapshot.h */
+
+// Lock-free snapshots of a running Game of Life.
+//
+// The engines already keep two boards and swap them every generation, so
+// generation g lives in buffers[g % 2] and stays untouched until generation
+// g + 2 starts overwriting it. The stepping side only announces that with two
+// atomic stores per generation: snapshot_begin() before it writes generation
+// g and snapshot_publish() once g is complete. It never waits and nothing is
+// copied.
+//
+// An observer picks the latest published generation, copies the region it
+// wants straight out of that buffer and then checks that generation + 2 has
+// not started in the meantime, like a seqlock reader. If it has, the copy may
+// be torn and is retried with the newer generation. A successful read is
+// always one consistent generation.
+//
+// On a large board the stepping side may publish faster than a region can be
+// copied, so after SNAPSHOT_OPTIMISTIC_TRIES failed copies the observer pins
+// the buffer it reads instead. The stepping side checks the pins of the
+// buffer it is about to overwrite in snapshot_begin() and waits until they
+// are released, so a pinned read always succeeds. Pins only appear after
+// failed copies, so normally the stepping side never waits.
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sched.h>
+
+#define SNAPSHOT_OPTIMISTIC_TRIES 8
+
+typedef struct {
+    int **buffers[2];      // Generation g is in buffers[g % 2]
+    int rows;
+    int cols;
+    atomic_long published; // Latest complete generation
+    atomic_long started;   // Generation currently being written
+    atomic_int pins[2];    // Observers holding each buffer against reuse
+} snapshot_t;
+
+// Set up a snapshot for two boards, with generation 0 in first
+static inline void snapshot_init(snapshot_t *snapshot, int **first, int **second, int rows, int cols) {
+    snapshot->buffers[0] = first;
+    snapshot->buffers[1] = second;
+    snapshot->rows = rows;
+    snapshot->cols = cols;
+    atomic_init(&snapshot->published, 0);
+    atomic_init(&snapshot->started, 0);
+    atomic_init(&snapshot->pins[0], 0);
+    atomic_init(&snapshot->pins[1], 0);
+}
+
+// Called by the stepping side before it writes any cell of generation; waits
+// while an observer has pinned the buffer that generation overwrites
+static inline void snapshot_begin(snapshot_t *snapshot, long generation) {
+    atomic_store_explicit(&snapshot->started, generation, memory_order_relaxed);
+    // Pairs with the fence in snapshot_pin(): either the observer sees this
+    // generation has started, or this side sees the observer's pin
+    atomic_thread_fence(memory_order_seq_cst);
+    while (atomic_load_explicit(&snapshot->pins[generation % 2], memory_order_acquire) > 0) {
+        sched_yield();
+    }
+}
+
+// Called by the stepping side once every cell of generation is written
+static inline void snapshot_publish(snapshot_t *snapshot, long generation) {
+    atomic_store_explicit(&snapshot->published, generation, memory_order_release);
+}
+
+// Latest complete generation
+static inline long snapshot_generation(snapshot_t *snapshot) {
+    return atomic_load_explicit(&snapshot->published, memory_order_acquire);
+}
+
+// Copy a region of one buffer into out as 0/1 bytes
+static inline void snapshot_copy(int **grid, int row, int col, int rows, int cols, uint8_t *out) {
+    for (int i = 0; i < rows; i++) {
+        const volatile int *source = grid[row + i] + col;
+        for (int j = 0; j < cols; j++) {
+            out[(long)i * cols + j] = source[j] != 0;
+        }
+    }
+}
+
+// Pin the buffer of the latest generation so the stepping side cannot reuse
+// it; returns that generation
+static inline long snapshot_pin(snapshot_t *snapshot) {
+    for (;;) {
+        long generation = atomic_load_explicit(&snapshot->published, memory_order_acquire);
+        atomic_fetch_add_explicit(&snapshot->pins[generation % 2], 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        // The buffer is only reused once generation + 2 starts
+        if (atomic_load_explicit(&snapshot->started, memory_order_relaxed) < generation + 2) {
+            return generation;
+        }
+        atomic_fetch_sub_explicit(&snapshot->pins[generation % 2], 1, memory_order_release);
+    }
+}
+
+// Copy a region of the latest generation into out (rows x cols, row-major,
+// 0 or 1 per cell). Returns the generation that was copied, or -1 if the
+// region is outside the board.
+static inline long snapshot_read(snapshot_t *snapshot, int row, int col, int rows, int cols, uint8_t *out) {
+    if (row < 0 || col < 0 || rows < 0 || cols < 0 || row + rows > snapshot->rows || col + cols > snapshot->cols) {
+        return -1;
+    }
+
+    for (int attempt = 0; attempt < SNAPSHOT_OPTIMISTIC_TRIES; attempt++) {
+        long generation = atomic_load_explicit(&snapshot->published, memory_order_acquire);
+        snapshot_copy(snapshot->buffers[generation % 2], row, col, rows, cols, out);
+
+        // The buffer is only reused once generation + 2 starts
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&snapshot->started, memory_order_relaxed) < generation + 2) {
+            return generation;
+        }
+    }
+
+    // Kept being overtaken: hold the buffer while copying
+    long generation = snapshot_pin(snapshot);
+    snapshot_copy(snapshot->buffers[generation % 2], row, col, rows, cols, out);
+    atomic_fetch_sub_explicit(&snapshot->pins[generation % 2], 1, memory_order_release);
+    return generation;
+}
+
+#endif
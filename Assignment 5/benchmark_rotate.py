@@ -0,0 +1,62 @@
+import sys
+import time
+import numpy as np
+import matplotlib.pyplot as plt
+
+from rotate import roll, roll_inplace
+
+# Compare np.roll with the CPU rotation library for 1K to 1G int32 elements
+# (pass a smaller largest size as the first argument on machines with less
+# than ~12 GB of memory). Every variant rotates left by one, like the
+# left_rotate GPU kernel, and its result is checked against np.roll.
+
+max_size = int(sys.argv[1]) if len(sys.argv) > 1 else 2 ** 30
+sizes = [2 ** p for p in range(10, 31, 2) if 2 ** p <= max_size]
+shift = -1
+
+
+def best_time(function, repetitions):
+    best = float('inf')
+    for _ in range(repetitions):
+        start = time.perf_counter()
+        function()
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+numpy_times, copy_times, inplace_times = [], [], []
+print(f"{'elements':>12} {'np.roll':>12} {'roll':>12} {'roll_inplace':>12} {'speedup':>8}")
+for size in sizes:
+    input_array = np.random.randint(0, 100, size=size, dtype=np.int32)
+    output_array = np.empty_like(input_array)
+    repetitions = 20 if size <= 2 ** 20 else 3
+
+    expected = np.roll(input_array, shift)
+    roll(input_array, shift, out=output_array)
+    working = input_array.copy()
+    roll_inplace(working, shift)
+    if not (np.array_equal(output_array, expected) and np.array_equal(working, expected)):
+        print(f"Validation Failed for {size} elements.")
+        sys.exit(1)
+    del expected, working
+
+    numpy_times.append(best_time(lambda: np.roll(input_array, shift), repetitions))
+    copy_times.append(best_time(lambda: roll(input_array, shift, out=output_array), repetitions))
+    inplace_times.append(best_time(lambda: roll_inplace(output_array, shift), repetitions))
+    print(f"{size:>12} {numpy_times[-1]:>12.6f} {copy_times[-1]:>12.6f} {inplace_times[-1]:>12.6f} "
+          f"{numpy_times[-1] / copy_times[-1]:>7.2f}x")
+
+# Plotting
+plt.figure(figsize=(10, 6))
+plt.plot(sizes, numpy_times, marker='o', label='np.roll')
+plt.plot(sizes, copy_times, marker='o', label='roll (library)')
+plt.plot(sizes, inplace_times, marker='o', label='roll_inplace (library)')
+plt.xscale('log')
+plt.yscale('log')
+plt.xlabel('Number of Elements', fontsize=12)
+plt.ylabel('Execution Time (seconds)', fontsize=12)
+plt.title('Rotation Time: np.roll vs CPU Library', fontsize=14)
+plt.grid(True, which="both", linestyle="--", linewidth=0.5)
+plt.legend(fontsize=12)
+plt.tight_layout()
+plt.savefig("rotation_benchmark.png")
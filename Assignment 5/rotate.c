@@ -0,0 +1,261 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <omp.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// CPU array rotation library, the replacement for the left_rotate GPU kernel
+//
+// Build: gcc -O3 -march=native -fopenmp -shared -fPIC rotate.c -o librotate.so
+// (rotate.py does this itself the first time it is imported)
+//
+// Rotations work on raw bytes, so any element type is rotated by scaling the
+// shift with the element size. A positive shift moves elements to the left
+// (element k ends up first); np.roll(a, s) is a left rotation by -s.
+//
+// rotate_left() rotates in place. While both sides of the rotation are
+// large, Gries-Mills block swaps put the shorter side in its final position;
+// each swap is of two disjoint blocks, so it is split over the OpenMP
+// threads. Once one side fits in BUFFER_BYTES it is parked in a buffer and
+// the other side is moved over by it, also in parallel: every thread first
+// saves the bytes at the edge of its chunk that a neighbour will overwrite.
+//
+// rotate_left_copy() writes the rotation to a separate array as two chunked
+// parallel copies. Above STREAMING_BYTES the copies use non-temporal stores,
+// so writing the result does not evict the source from cache or read the
+// destination lines in first.
+
+#define PARALLEL_BYTES (256 * 1024)        // Smaller work stays on one thread
+#define STREAMING_BYTES (8 * 1024 * 1024)  // Larger copies bypass the cache
+#define BUFFER_BYTES (64 * 1024)           // Largest side rotated through a buffer
+#define COPY_CHUNK (1024 * 1024)
+#define SWAP_CHUNK 4096
+
+// Function prototypes
+int rotate_left(void *data, size_t count, size_t element_size, long long shift);
+int rotate_left_copy(const void *source, void *destination, size_t count, size_t element_size, long long shift);
+static size_t normalize_shift(size_t count, long long shift);
+static int rotate_bytes(unsigned char *base, size_t length, size_t shift);
+static int rotate_buffered(unsigned char *base, size_t length, size_t shift);
+static int shift_down(unsigned char *base, size_t length, size_t offset);
+static int shift_up(unsigned char *base, size_t length, size_t offset);
+static void swap_blocks(unsigned char *a, unsigned char *b, size_t length);
+static void copy_chunked(unsigned char *destination, const unsigned char *source, size_t length);
+static void stream_copy(unsigned char *destination, const unsigned char *source, size_t length);
+
+// Rotate count elements left by shift in place; returns 0 on success
+int rotate_left(void *data, size_t count, size_t element_size, long long shift) {
+    if (count < 2 || element_size == 0) {
+        return 0;
+    }
+    size_t k = normalize_shift(count, shift);
+    return rotate_bytes(data, count * element_size, k * element_size);
+}
+
+// Write count elements rotated left by shift to a separate, non-overlapping array
+int rotate_left_copy(const void *source, void *destination, size_t count, size_t element_size, long long shift) {
+    if (source == destination) {
+        return rotate_left(destination, count, element_size, shift);
+    }
+    if (count == 0 || element_size == 0) {
+        return 0;
+    }
+    size_t k = normalize_shift(count, shift) * element_size;
+    size_t length = count * element_size;
+    const unsigned char *src = source;
+    unsigned char *dst = destination;
+
+    copy_chunked(dst, src + k, length - k);
+    copy_chunked(dst + length - k, src, k);
+    return 0;
+}
+
+// Shift reduced to [0, count), negative shifts rotating right
+static size_t normalize_shift(size_t count, long long shift) {
+    if (shift >= 0) {
+        return (size_t)shift % count;
+    }
+    size_t right = (size_t)(-(shift + 1)) % count + 1;
+    return right == count ? 0 : count - right;
+}
+
+// In-place rotation of length bytes left by shift bytes
+static int rotate_bytes(unsigned char *base, size_t length, size_t shift) {
+    while (shift > 0 && shift < length) {
+        size_t right = length - shift;
+        if (shift <= BUFFER_BYTES || right <= BUFFER_BYTES) {
+            return rotate_buffered(base, length, shift);
+        }
+
+        if (shift <= right) {
+            // A B1 B2 with |B2| = |A|: swapping A and B2 leaves A in place
+            swap_blocks(base, base + length - shift, shift);
+            length -= shift;
+        } else {
+            // A1 A2 B with |A1| = |B|: swapping A1 and B leaves B in place
+            swap_blocks(base, base + shift, right);
+            base += right;
+            length -= right;
+            shift -= right;
+        }
+    }
+    return 0;
+}
+
+// Rotation where one side is small enough to park in a buffer
+static int rotate_buffered(unsigned char *base, size_t length, size_t shift) {
+    size_t right = length - shift;
+    size_t parked = shift <= right ? shift : right;
+    unsigned char *buffer = malloc(parked);
+    if (buffer == NULL) {
+        return -1;
+    }
+
+    int status;
+    if (shift <= right) {
+        memcpy(buffer, base, shift);
+        status = shift_down(base, right, shift);
+        memcpy(base + right, buffer, shift);
+    } else {
+        memcpy(buffer, base + shift, right);
+        status = shift_up(base, shift, right);
+        memcpy(base, buffer, right);
+    }
+    free(buffer);
+    return status;
+}
+
+// Move length bytes from base + offset down to base (offset is small)
+static int shift_down(unsigned char *base, size_t length, size_t offset) {
+    int threads = length > PARALLEL_BYTES ? omp_get_max_threads() : 1;
+    if (threads == 1 || length / threads <= offset) {
+        memmove(base, base + offset, length);
+        return 0;
+    }
+    unsigned char *edges = malloc((size_t)threads * offset);
+    if (edges == NULL) {
+        return -1;
+    }
+
+    #pragma omp parallel num_threads(threads)
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        size_t per = length / nt, extra = length % nt, index = (size_t)t;
+        size_t start = per * index + (index < extra ? index : extra);
+        size_t end = start + per + (index < extra);
+
+        // The last offset bytes this chunk reads are overwritten by the next chunk
+        if (t < nt - 1) {
+            memcpy(edges + (size_t)t * offset, base + end, offset);
+        }
+        #pragma omp barrier
+
+        if (t < nt - 1) {
+            memmove(base + start, base + start + offset, end - start - offset);
+            memcpy(base + end - offset, edges + (size_t)t * offset, offset);
+        } else {
+            memmove(base + start, base + start + offset, end - start);
+        }
+    }
+    free(edges);
+    return 0;
+}
+
+// Move length bytes from base up to base + offset (offset is small)
+static int shift_up(unsigned char *base, size_t length, size_t offset) {
+    int threads = length > PARALLEL_BYTES ? omp_get_max_threads() : 1;
+    if (threads == 1 || length / threads <= offset) {
+        memmove(base + offset, base, length);
+        return 0;
+    }
+    unsigned char *edges = malloc((size_t)threads * offset);
+    if (edges == NULL) {
+        return -1;
+    }
+
+    #pragma omp parallel num_threads(threads)
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        size_t per = length / nt, extra = length % nt, index = (size_t)t;
+        size_t start = per * index + (index < extra ? index : extra);
+        size_t end = start + per + (index < extra);
+
+        // The first offset bytes of this chunk are overwritten by the previous chunk
+        if (t > 0) {
+            memcpy(edges + (size_t)t * offset, base + start, offset);
+        }
+        #pragma omp barrier
+
+        if (t > 0) {
+            memmove(base + start + 2 * offset, base + start + offset, end - start - offset);
+            memcpy(base + start + offset, edges + (size_t)t * offset, offset);
+        } else {
+            memmove(base + start + offset, base + start, end - start);
+        }
+    }
+    free(edges);
+    return 0;
+}
+
+// Exchange two disjoint blocks of length bytes
+static void swap_blocks(unsigned char *a, unsigned char *b, size_t length) {
+    size_t chunks = (length + SWAP_CHUNK - 1) / SWAP_CHUNK;
+
+    #pragma omp parallel for schedule(static) if (length > PARALLEL_BYTES)
+    for (size_t c = 0; c < chunks; c++) {
+        unsigned char temp[SWAP_CHUNK];
+        size_t offset = c * SWAP_CHUNK;
+        size_t bytes = length - offset < SWAP_CHUNK ? length - offset : SWAP_CHUNK;
+        memcpy(temp, a + offset, bytes);
+        memcpy(a + offset, b + offset, bytes);
+        memcpy(b + offset, temp, bytes);
+    }
+}
+
+// Copy between non-overlapping buffers in parallel chunks
+static void copy_chunked(unsigned char *destination, const unsigned char *source, size_t length) {
+    if (length <= PARALLEL_BYTES) {
+        memcpy(destination, source, length);
+        return;
+    }
+    size_t chunks = (length + COPY_CHUNK - 1) / COPY_CHUNK;
+    int streaming = length > STREAMING_BYTES;
+
+    #pragma omp parallel for schedule(static)
+    for (size_t c = 0; c < chunks; c++) {
+        size_t offset = c * COPY_CHUNK;
+        size_t bytes = length - offset < COPY_CHUNK ? length - offset : COPY_CHUNK;
+        if (streaming) {
+            stream_copy(destination + offset, source + offset, bytes);
+        } else {
+            memcpy(destination + offset, source + offset, bytes);
+        }
+    }
+}
+
+// Copy with non-temporal stores where the CPU has them
+static void stream_copy(unsigned char *destination, const unsigned char *source, size_t length) {
+#ifdef __SSE2__
+    size_t head = (16 - ((uintptr_t)destination & 15)) & 15;
+    head = head < length ? head : length;
+    memcpy(destination, source, head);
+
+    size_t i = head;
+    for (; i + 64 <= length; i += 64) {
+        __m128i v0 = _mm_loadu_si128((const __m128i *)(source + i));
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(source + i + 16));
+        __m128i v2 = _mm_loadu_si128((const __m128i *)(source + i + 32));
+        __m128i v3 = _mm_loadu_si128((const __m128i *)(source + i + 48));
+        _mm_stream_si128((__m128i *)(destination + i), v0);
+        _mm_stream_si128((__m128i *)(destination + i + 16), v1);
+        _mm_stream_si128((__m128i *)(destination + i + 32), v2);
+        _mm_stream_si128((__m128i *)(destination + i + 48), v3);
+    }
+    memcpy(destination + i, source + i, length - i);
+    _mm_sfence();
+#else
+    memcpy(destination, source, length);
+#endif
+}
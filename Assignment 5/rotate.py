@@ -0,0 +1,57 @@
+"""Zero-copy numpy interface to the CPU rotation library in rotate.c.
+
+roll() behaves like np.roll(a, shift) without an axis, roll_inplace() does
+the same rotation inside the array's own buffer. Both hand the numpy data
+pointer straight to the library, so nothing is copied on the Python side,
+and ctypes releases the GIL for the duration of the call.
+"""
+
+import ctypes
+import os
+import subprocess
+
+import numpy as np
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SOURCE = os.path.join(HERE, 'rotate.c')
+LIBRARY = os.path.join(HERE, 'librotate.so')
+
+
+def _load():
+    # Build the library on first use, or again when rotate.c has changed
+    if not os.path.exists(LIBRARY) or os.path.getmtime(LIBRARY) < os.path.getmtime(SOURCE):
+        subprocess.check_call(['gcc', '-O3', '-march=native', '-fopenmp', '-shared', '-fPIC',
+                               SOURCE, '-o', LIBRARY])
+    library = ctypes.CDLL(LIBRARY)
+    library.rotate_left.argtypes = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_size_t, ctypes.c_longlong]
+    library.rotate_left.restype = ctypes.c_int
+    library.rotate_left_copy.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t, ctypes.c_size_t,
+                                         ctypes.c_longlong]
+    library.rotate_left_copy.restype = ctypes.c_int
+    return library
+
+
+_library = _load()
+
+
+def roll_inplace(a, shift):
+    """Rotate a C-contiguous array in place, like a[...] = np.roll(a, shift)."""
+    if not a.flags['C_CONTIGUOUS'] or not a.flags['WRITEABLE']:
+        raise ValueError('roll_inplace needs a writeable C-contiguous array')
+    if _library.rotate_left(a.ctypes.data, a.size, a.itemsize, -int(shift)) != 0:
+        raise MemoryError('rotation buffer allocation failed')
+    return a
+
+
+def roll(a, shift, out=None):
+    """Return np.roll(a, shift) for the flattened array, optionally into out."""
+    a = np.ascontiguousarray(a)
+    if out is None:
+        out = np.empty_like(a)
+    elif out.shape != a.shape or out.dtype != a.dtype or not out.flags['C_CONTIGUOUS']:
+        raise ValueError('out must be a C-contiguous array with the shape and dtype of a')
+    if np.shares_memory(a, out) and out.ctypes.data != a.ctypes.data:
+        raise ValueError('out must not partially overlap a')
+    if _library.rotate_left_copy(a.ctypes.data, out.ctypes.data, a.size, a.itemsize, -int(shift)) != 0:
+        raise MemoryError('rotation buffer allocation failed')
+    return out
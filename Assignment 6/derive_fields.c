@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+#include "wervel.h"
+#include "derived_fields.h"
+
+// Compute vorticity, Q-criterion and lambda2 for the wervel field and store
+// them in its cache next to the input columns
+//
+// Usage: derive_fields <wervel.csv>
+//
+// Afterwards e.g. "isosurface wervel.csv q.vtk q_criterion 0.5" contours the
+// Q-criterion without recomputing anything.
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <wervel.csv>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    wervel_field_t field;
+    if (wervel_open(argv[1], &field) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    double start = omp_get_wtime();
+    if (derive_fields(&field) != 0) {
+        fprintf(stderr, "No room or memory for the derived columns.\n");
+        return EXIT_FAILURE;
+    }
+    double elapsed = omp_get_wtime() - start;
+
+    printf("Grid %dx%dx%d, derived in %.6fs (%d threads)\n", field.dims[0], field.dims[1], field.dims[2],
+           elapsed, omp_get_max_threads());
+    for (int c = 0; c < DERIVED_NUM_COLUMNS; c++) {
+        const float *values = field.columns[wervel_column(&field, derived_column_names[c])];
+        float lo = INFINITY, hi = -INFINITY;
+        for (long p = 0; p < field.num_points; p++) {
+            lo = fminf(lo, values[p]);
+            hi = fmaxf(hi, values[p]);
+        }
+        printf("%-12s [%g, %g]\n", derived_column_names[c], lo, hi);
+    }
+
+    int status = wervel_save(argv[1], &field);
+    wervel_free(&field);
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,169 @@
+/* File: derived_fields.h */
+
+// Vortex identification fields derived from the velocity columns of a wervel
+// field: the vorticity vector and its magnitude, the Q-criterion and lambda2.
+// They are stored as extra columns of the field (see derived_column_names), so
+// anything that takes a column name, such as the isosurface tool, can use
+// them directly once wervel_save() has written them to the cache.
+//
+// All of them come from the velocity gradient J[a][b] = d v_a / d x_b, taken
+// with central differences (one-sided on the grid faces). The grid is cut
+// into bricks of DERIVED_TILE_SLABS z-slabs by DERIVED_TILE_ROWS rows, which
+// are shared over the OpenMP threads. A brick is swept along z, so the rows
+// of plane k + 1 it loads are still in cache when they serve as plane k and
+// then k - 1, instead of being fetched again for each of the three slabs that
+// read them. The loop along x is written without branches and marked simd, and
+// leaves out the two things that would keep gcc from vectorising it without
+// -ffast-math: sqrtf (which may set errno) and the acos/cos of the eigenvalue
+// solve. It stores the curl and the six entries of the symmetric tensor
+// lambda2 is taken from, and a second pass over the points finishes the
+// vorticity magnitude and lambda2.
+
+#ifndef DERIVED_FIELDS_H
+#define DERIVED_FIELDS_H
+
+#include <math.h>
+#include "wervel.h"
+
+#define DERIVED_TILE_ROWS 16 // Brick size along y
+#define DERIVED_TILE_SLABS 8 // Brick size along z
+
+enum { DERIVED_WX, DERIVED_WY, DERIVED_WZ, DERIVED_VORTICITY, DERIVED_Q, DERIVED_LAMBDA2, DERIVED_NUM_COLUMNS };
+
+static const char *derived_column_names[DERIVED_NUM_COLUMNS] = {"wx", "wy", "wz", "vorticity", "q_criterion", "lambda2"};
+
+// Middle eigenvalue of a symmetric 3x3 matrix, using the closed form for the
+// roots of its characteristic polynomial. Evaluated in double because the
+// float version loses several digits when two eigenvalues coincide.
+static inline float derived_middle_eigenvalue(double a00, double a11, double a22, double a01, double a02, double a12) {
+    double q = (a00 + a11 + a22) / 3.0;
+    double p1 = a01 * a01 + a02 * a02 + a12 * a12;
+    double p2 = (a00 - q) * (a00 - q) + (a11 - q) * (a11 - q) + (a22 - q) * (a22 - q) + 2.0 * p1;
+    double p = sqrt(fmax(p2 / 6.0, 1e-300));
+
+    // B = (A - qI) / p, r = det(B) / 2
+    double b00 = (a00 - q) / p, b11 = (a11 - q) / p, b22 = (a22 - q) / p;
+    double b01 = a01 / p, b02 = a02 / p, b12 = a12 / p;
+    double r = 0.5 * (b00 * (b11 * b22 - b12 * b12) - b01 * (b01 * b22 - b12 * b02) + b02 * (b01 * b12 - b11 * b02));
+    r = fmin(fmax(r, -1.0), 1.0);
+
+    double phi = acos(r) / 3.0;
+    double largest = q + 2.0 * p * cos(phi);
+    double smallest = q + 2.0 * p * cos(phi + 2.0 * M_PI / 3.0);
+    return (float)(3.0 * q - largest - smallest);
+}
+
+// Compute all derived columns, adding them to the field if they are missing.
+// Returns -1 if the field has no room for them or memory runs out.
+static inline int derive_fields(wervel_field_t *field) {
+    int out[DERIVED_NUM_COLUMNS];
+    for (int c = 0; c < DERIVED_NUM_COLUMNS; c++) {
+        out[c] = wervel_ensure_column(field, derived_column_names[c]);
+        if (out[c] < 0) {
+            return -1;
+        }
+    }
+
+    const int nx = field->dims[0], ny = field->dims[1], nz = field->dims[2];
+    const long sy = nx, sz = (long)nx * ny;
+    const float *v[3] = {field->columns[WERVEL_VX], field->columns[WERVEL_VY], field->columns[WERVEL_VZ]};
+    float *wx = field->columns[out[DERIVED_WX]], *wy = field->columns[out[DERIVED_WY]], *wz = field->columns[out[DERIVED_WZ]];
+    float *vorticity = field->columns[out[DERIVED_VORTICITY]];
+    float *q_criterion = field->columns[out[DERIVED_Q]];
+    float *lambda2 = field->columns[out[DERIVED_LAMBDA2]];
+    const float hx = (float)field->spacing[0], hy = (float)field->spacing[1], hz = (float)field->spacing[2];
+    const long n = field->num_points;
+
+    // S^2 + Omega^2 per point, one array per entry: 00, 11, 22, 01, 02, 12
+    float *tensor = malloc(6 * n * sizeof(float));
+    if (tensor == NULL) {
+        return -1;
+    }
+    float *m00 = tensor, *m11 = tensor + n, *m22 = tensor + 2 * n;
+    float *m01 = tensor + 3 * n, *m02 = tensor + 4 * n, *m12 = tensor + 5 * n;
+
+    const int bricks_y = (ny + DERIVED_TILE_ROWS - 1) / DERIVED_TILE_ROWS;
+    const int bricks_z = (nz + DERIVED_TILE_SLABS - 1) / DERIVED_TILE_SLABS;
+
+    #pragma omp parallel for collapse(2) schedule(static)
+    for (int brick_z = 0; brick_z < bricks_z; brick_z++) {
+        for (int brick_y = 0; brick_y < bricks_y; brick_y++) {
+            int k_end = (brick_z + 1) * DERIVED_TILE_SLABS < nz ? (brick_z + 1) * DERIVED_TILE_SLABS : nz;
+            int j_end = (brick_y + 1) * DERIVED_TILE_ROWS < ny ? (brick_y + 1) * DERIVED_TILE_ROWS : ny;
+            for (int k = brick_z * DERIVED_TILE_SLABS; k < k_end; k++) {
+                int km = k > 0 ? k - 1 : k, kp = k < nz - 1 ? k + 1 : k;
+                float inv_z = kp > km ? 1.0f / ((kp - km) * hz) : 0.0f;
+
+                for (int j = brick_y * DERIVED_TILE_ROWS; j < j_end; j++) {
+                    int jm = j > 0 ? j - 1 : j, jp = j < ny - 1 ? j + 1 : j;
+                    float inv_y = jp > jm ? 1.0f / ((jp - jm) * hy) : 0.0f;
+                    long row = k * sz + j * sy;
+
+                    #pragma omp simd
+                    for (int i = 0; i < nx; i++) {
+                        int im = i > 0 ? i - 1 : i, ip = i < nx - 1 ? i + 1 : i;
+                        float inv_x = ip > im ? 1.0f / ((ip - im) * hx) : 0.0f;
+
+                        // J[a][b] = d v_a / d x_b
+                        float J[3][3];
+                        for (int a = 0; a < 3; a++) {
+                            J[a][0] = (v[a][row + ip] - v[a][row + im]) * inv_x;
+                            J[a][1] = (v[a][k * sz + jp * sy + i] - v[a][k * sz + jm * sy + i]) * inv_y;
+                            J[a][2] = (v[a][kp * sz + j * sy + i] - v[a][km * sz + j * sy + i]) * inv_z;
+                        }
+
+                        float curl_x = J[2][1] - J[1][2];
+                        float curl_y = J[0][2] - J[2][0];
+                        float curl_z = J[1][0] - J[0][1];
+                        wx[row + i] = curl_x;
+                        wy[row + i] = curl_y;
+                        wz[row + i] = curl_z;
+
+                        // Strain rate S and rotation Omega
+                        float S[3][3], W[3][3];
+                        for (int a = 0; a < 3; a++) {
+                            for (int b = 0; b < 3; b++) {
+                                S[a][b] = 0.5f * (J[a][b] + J[b][a]);
+                                W[a][b] = 0.5f * (J[a][b] - J[b][a]);
+                            }
+                        }
+
+                        float norm_s = 0.0f, norm_w = 0.0f;
+                        for (int a = 0; a < 3; a++) {
+                            for (int b = 0; b < 3; b++) {
+                                norm_s += S[a][b] * S[a][b];
+                                norm_w += W[a][b] * W[a][b];
+                            }
+                        }
+                        q_criterion[row + i] = 0.5f * (norm_w - norm_s);
+
+                        // lambda2 is the middle eigenvalue of S^2 + Omega^2, which is symmetric
+                        float M[3][3];
+                        for (int a = 0; a < 3; a++) {
+                            for (int b = 0; b < 3; b++) {
+                                M[a][b] = S[a][0] * S[0][b] + S[a][1] * S[1][b] + S[a][2] * S[2][b] +
+                                          W[a][0] * W[0][b] + W[a][1] * W[1][b] + W[a][2] * W[2][b];
+                            }
+                        }
+                        m00[row + i] = M[0][0];
+                        m11[row + i] = M[1][1];
+                        m22[row + i] = M[2][2];
+                        m01[row + i] = M[0][1];
+                        m02[row + i] = M[0][2];
+                        m12[row + i] = M[1][2];
+                    }
+                }
+            }
+        }
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long p = 0; p < n; p++) {
+        vorticity[p] = sqrtf(wx[p] * wx[p] + wy[p] * wy[p] + wz[p] * wz[p]);
+        lambda2[p] = derived_middle_eigenvalue(m00[p], m11[p], m22[p], m01[p], m02[p], m12[p]);
+    }
+    free(tensor);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,798 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "wervel.h"
+
+// Parallel isosurface extraction on the wervel grid
+//
+// Usage: isosurface <wervel.csv> <output.vtk> <column> <isovalue> [isovalue ...]
+//
+// column is any column of the field, or "magnitude" for the velocity
+// magnitude that the Calculator in assignment6.pvsm feeds into its Contour.
+// With several isovalues, e.g. for an animation sweep, the outputs are
+// numbered output_000.vtk, output_001.vtk, ...
+//
+// Cells are grouped into blocks of BLOCK^3 with a min/max tree on top, so a
+// query only visits blocks whose value range contains the isovalue. Active
+// blocks are split over the threads; each thread appends triangles to its
+// own buffer and a prefix sum over the buffer sizes gives every thread its
+// place in the output, so no locks are taken. Cells are triangulated with
+// marching cubes: the eight corners above or below the isovalue pick one of
+// 256 cases, and edge_table and triangle_table give the edges the surface
+// crosses and the triangles between those crossings. The tables separate the
+// corners at or above the isovalue wherever a cell face is ambiguous; that
+// choice only depends on the face, so neighbouring cells agree and the
+// surface has no cracks. Triangles are wound with their normal pointing to
+// higher values.
+//
+// Every surface vertex lies on an edge between two grid points, and the
+// vertices are shared between the triangles around that edge: each thread
+// keeps a table keyed by edge, and one thread then merges the per-thread
+// vertex lists, which only overlap on the faces of blocks that different
+// threads handled. The output is an indexed mesh with one point per edge.
+
+#define BLOCK 8
+
+// Min/max of one level of the tree; level 0 holds the blocks of cells
+typedef struct {
+    int dims[3];
+    float *min;
+    float *max;
+} tree_level_t;
+
+typedef struct {
+    int num_levels;
+    tree_level_t *levels;
+} minmax_tree_t;
+
+// Triangles found by one thread, as vertex numbers into its own vertex list
+typedef struct {
+    float *points;       // xyz per vertex
+    uint64_t *edges;     // Edge key per vertex (see edge_key)
+    long *merged;        // Vertex number in the output, after merging
+    long num_vertices;
+    long vertex_capacity;
+    long *slots;         // Hash table from edge key to vertex number, -1 if free
+    long num_slots;
+    int32_t *triangles;  // Three vertex numbers each
+    long count;
+    long capacity;
+} triangle_buffer_t;
+
+// Cube edges as pairs of corners, with bit 0 = +x, bit 1 = +y, bit 2 = +z
+static const int cube_edges[12][2] = {
+    {0, 1}, {1, 3}, {3, 2}, {2, 0}, {4, 5}, {5, 7}, {7, 6}, {6, 4}, {0, 4}, {1, 5}, {3, 7}, {2, 6},
+};
+
+// Crossed cube edges for each case, one bit per edge; bit c of the case is
+// set when corner c is at or above the isovalue
+static const uint16_t edge_table[256] = {
+    0x000, 0x109, 0x203, 0x30a, 0x80c, 0x905, 0xa0f, 0xb06,
+    0x406, 0x50f, 0x605, 0x70c, 0xc0a, 0xd03, 0xe09, 0xf00,
+    0x190, 0x099, 0x393, 0x29a, 0x99c, 0x895, 0xb9f, 0xa96,
+    0x596, 0x49f, 0x795, 0x69c, 0xd9a, 0xc93, 0xf99, 0xe90,
+    0x230, 0x339, 0x033, 0x13a, 0xa3c, 0xb35, 0x83f, 0x936,
+    0x636, 0x73f, 0x435, 0x53c, 0xe3a, 0xf33, 0xc39, 0xd30,
+    0x3a0, 0x2a9, 0x1a3, 0x0aa, 0xbac, 0xaa5, 0x9af, 0x8a6,
+    0x7a6, 0x6af, 0x5a5, 0x4ac, 0xfaa, 0xea3, 0xda9, 0xca0,
+    0x8c0, 0x9c9, 0xac3, 0xbca, 0x0cc, 0x1c5, 0x2cf, 0x3c6,
+    0xcc6, 0xdcf, 0xec5, 0xfcc, 0x4ca, 0x5c3, 0x6c9, 0x7c0,
+    0x950, 0x859, 0xb53, 0xa5a, 0x15c, 0x055, 0x35f, 0x256,
+    0xd56, 0xc5f, 0xf55, 0xe5c, 0x55a, 0x453, 0x759, 0x650,
+    0xaf0, 0xbf9, 0x8f3, 0x9fa, 0x2fc, 0x3f5, 0x0ff, 0x1f6,
+    0xef6, 0xfff, 0xcf5, 0xdfc, 0x6fa, 0x7f3, 0x4f9, 0x5f0,
+    0xb60, 0xa69, 0x963, 0x86a, 0x36c, 0x265, 0x16f, 0x066,
+    0xf66, 0xe6f, 0xd65, 0xc6c, 0x76a, 0x663, 0x569, 0x460,
+    0x460, 0x569, 0x663, 0x76a, 0xc6c, 0xd65, 0xe6f, 0xf66,
+    0x066, 0x16f, 0x265, 0x36c, 0x86a, 0x963, 0xa69, 0xb60,
+    0x5f0, 0x4f9, 0x7f3, 0x6fa, 0xdfc, 0xcf5, 0xfff, 0xef6,
+    0x1f6, 0x0ff, 0x3f5, 0x2fc, 0x9fa, 0x8f3, 0xbf9, 0xaf0,
+    0x650, 0x759, 0x453, 0x55a, 0xe5c, 0xf55, 0xc5f, 0xd56,
+    0x256, 0x35f, 0x055, 0x15c, 0xa5a, 0xb53, 0x859, 0x950,
+    0x7c0, 0x6c9, 0x5c3, 0x4ca, 0xfcc, 0xec5, 0xdcf, 0xcc6,
+    0x3c6, 0x2cf, 0x1c5, 0x0cc, 0xbca, 0xac3, 0x9c9, 0x8c0,
+    0xca0, 0xda9, 0xea3, 0xfaa, 0x4ac, 0x5a5, 0x6af, 0x7a6,
+    0x8a6, 0x9af, 0xaa5, 0xbac, 0x0aa, 0x1a3, 0x2a9, 0x3a0,
+    0xd30, 0xc39, 0xf33, 0xe3a, 0x53c, 0x435, 0x73f, 0x636,
+    0x936, 0x83f, 0xb35, 0xa3c, 0x13a, 0x033, 0x339, 0x230,
+    0xe90, 0xf99, 0xc93, 0xd9a, 0x69c, 0x795, 0x49f, 0x596,
+    0xa96, 0xb9f, 0x895, 0x99c, 0x29a, 0x393, 0x099, 0x190,
+    0xf00, 0xe09, 0xd03, 0xc0a, 0x70c, 0x605, 0x50f, 0x406,
+    0xb06, 0xa0f, 0x905, 0x80c, 0x30a, 0x203, 0x109, 0x000,
+};
+
+// Triangles for each case as triples of cube edges, ended by -1
+static const int8_t triangle_table[256][16] = {
+    {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 8, 3, 1, 9, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 2, 0, 8, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 1, 9, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 11, 2, 1, 8, 11, 1, 9, 8, -1, -1, -1, -1, -1, -1, -1},
+    {1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 10, 9, 0, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {2, 8, 3, 2, 9, 8, 2, 10, 9, -1, -1, -1, -1, -1, -1, -1},
+    {1, 11, 10, 1, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 10, 1, 0, 11, 10, 0, 8, 11, -1, -1, -1, -1, -1, -1, -1},
+    {0, 10, 9, 0, 11, 10, 0, 3, 11, -1, -1, -1, -1, -1, -1, -1},
+    {8, 10, 9, 8, 11, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 7, 3, 0, 4, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 1, 9, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 7, 3, 1, 4, 7, 1, 9, 4, -1, -1, -1, -1, -1, -1, -1},
+    {2, 3, 11, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 2, 0, 7, 11, 0, 4, 7, -1, -1, -1, -1, -1, -1, -1},
+    {0, 1, 9, 2, 3, 11, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1},
+    {1, 11, 2, 1, 7, 11, 1, 4, 7, 1, 9, 4, -1, -1, -1, -1},
+    {1, 2, 10, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 7, 3, 0, 4, 7, 1, 2, 10, -1, -1, -1, -1, -1, -1, -1},
+    {0, 10, 9, 0, 2, 10, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1},
+    {2, 7, 3, 2, 4, 7, 2, 9, 4, 2, 10, 9, -1, -1, -1, -1},
+    {1, 11, 10, 1, 3, 11, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1},
+    {0, 10, 1, 0, 11, 10, 0, 7, 11, 0, 4, 7, -1, -1, -1, -1},
+    {0, 10, 9, 0, 11, 10, 0, 3, 11, 4, 7, 8, -1, -1, -1, -1},
+    {4, 10, 9, 4, 11, 10, 4, 7, 11, -1, -1, -1, -1, -1, -1, -1},
+    {4, 9, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 5, 4, 0, 1, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 8, 3, 1, 4, 8, 1, 5, 4, -1, -1, -1, -1, -1, -1, -1},
+    {2, 3, 11, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 2, 0, 8, 11, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
+    {0, 5, 4, 0, 1, 5, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1},
+    {1, 11, 2, 1, 8, 11, 1, 4, 8, 1, 5, 4, -1, -1, -1, -1},
+    {1, 2, 10, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 1, 2, 10, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
+    {0, 5, 4, 0, 10, 5, 0, 2, 10, -1, -1, -1, -1, -1, -1, -1},
+    {2, 8, 3, 2, 4, 8, 2, 5, 4, 2, 10, 5, -1, -1, -1, -1},
+    {1, 11, 10, 1, 3, 11, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
+    {0, 10, 1, 0, 11, 10, 0, 8, 11, 4, 9, 5, -1, -1, -1, -1},
+    {0, 5, 4, 0, 10, 5, 0, 11, 10, 0, 3, 11, -1, -1, -1, -1},
+    {4, 10, 5, 4, 11, 10, 4, 8, 11, -1, -1, -1, -1, -1, -1, -1},
+    {5, 8, 9, 5, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 7, 3, 0, 5, 7, 0, 9, 5, -1, -1, -1, -1, -1, -1, -1},
+    {0, 7, 8, 0, 5, 7, 0, 1, 5, -1, -1, -1, -1, -1, -1, -1},
+    {1, 7, 3, 1, 5, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {2, 3, 11, 5, 8, 9, 5, 7, 8, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 2, 0, 7, 11, 0, 5, 7, 0, 9, 5, -1, -1, -1, -1},
+    {0, 7, 8, 0, 5, 7, 0, 1, 5, 2, 3, 11, -1, -1, -1, -1},
+    {1, 11, 2, 1, 7, 11, 1, 5, 7, -1, -1, -1, -1, -1, -1, -1},
+    {1, 2, 10, 5, 8, 9, 5, 7, 8, -1, -1, -1, -1, -1, -1, -1},
+    {0, 7, 3, 0, 5, 7, 0, 9, 5, 1, 2, 10, -1, -1, -1, -1},
+    {0, 7, 8, 0, 5, 7, 0, 10, 5, 0, 2, 10, -1, -1, -1, -1},
+    {2, 7, 3, 2, 5, 7, 2, 10, 5, -1, -1, -1, -1, -1, -1, -1},
+    {1, 11, 10, 1, 3, 11, 5, 8, 9, 5, 7, 8, -1, -1, -1, -1},
+    {0, 10, 1, 0, 11, 10, 0, 7, 11, 0, 5, 7, 0, 9, 5, -1},
+    {0, 7, 8, 0, 5, 7, 0, 10, 5, 0, 11, 10, 0, 3, 11, -1},
+    {5, 11, 10, 5, 7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {6, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 1, 9, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 8, 3, 1, 9, 8, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {2, 7, 6, 2, 3, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 6, 2, 0, 7, 6, 0, 8, 7, -1, -1, -1, -1, -1, -1, -1},
+    {0, 1, 9, 2, 7, 6, 2, 3, 7, -1, -1, -1, -1, -1, -1, -1},
+    {1, 6, 2, 1, 7, 6, 1, 8, 7, 1, 9, 8, -1, -1, -1, -1},
+    {1, 2, 10, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 1, 2, 10, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {0, 10, 9, 0, 2, 10, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {2, 8, 3, 2, 9, 8, 2, 10, 9, 6, 11, 7, -1, -1, -1, -1},
+    {1, 6, 10, 1, 7, 6, 1, 3, 7, -1, -1, -1, -1, -1, -1, -1},
+    {0, 10, 1, 0, 6, 10, 0, 7, 6, 0, 8, 7, -1, -1, -1, -1},
+    {0, 10, 9, 0, 6, 10, 0, 7, 6, 0, 3, 7, -1, -1, -1, -1},
+    {6, 8, 7, 6, 9, 8, 6, 10, 9, -1, -1, -1, -1, -1, -1, -1},
+    {4, 11, 8, 4, 6, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 3, 0, 6, 11, 0, 4, 6, -1, -1, -1, -1, -1, -1, -1},
+    {0, 1, 9, 4, 11, 8, 4, 6, 11, -1, -1, -1, -1, -1, -1, -1},
+    {1, 11, 3, 1, 6, 11, 1, 4, 6, 1, 9, 4, -1, -1, -1, -1},
+    {2, 4, 6, 2, 8, 4, 2, 3, 8, -1, -1, -1, -1, -1, -1, -1},
+    {0, 6, 2, 0, 4, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 1, 9, 2, 4, 6, 2, 8, 4, 2, 3, 8, -1, -1, -1, -1},
+    {1, 6, 2, 1, 4, 6, 1, 9, 4, -1, -1, -1, -1, -1, -1, -1},
+    {1, 2, 10, 4, 11, 8, 4, 6, 11, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 3, 0, 6, 11, 0, 4, 6, 1, 2, 10, -1, -1, -1, -1},
+    {0, 10, 9, 0, 2, 10, 4, 11, 8, 4, 6, 11, -1, -1, -1, -1},
+    {2, 11, 3, 2, 6, 11, 2, 4, 6, 2, 9, 4, 2, 10, 9, -1},
+    {1, 6, 10, 1, 4, 6, 1, 8, 4, 1, 3, 8, -1, -1, -1, -1},
+    {0, 10, 1, 0, 6, 10, 0, 4, 6, -1, -1, -1, -1, -1, -1, -1},
+    {0, 10, 9, 0, 6, 10, 0, 4, 6, 0, 8, 4, 0, 3, 8, -1},
+    {4, 10, 9, 4, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 9, 5, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 4, 9, 5, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {0, 5, 4, 0, 1, 5, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {1, 8, 3, 1, 4, 8, 1, 5, 4, 6, 11, 7, -1, -1, -1, -1},
+    {2, 7, 6, 2, 3, 7, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
+    {0, 6, 2, 0, 7, 6, 0, 8, 7, 4, 9, 5, -1, -1, -1, -1},
+    {0, 5, 4, 0, 1, 5, 2, 7, 6, 2, 3, 7, -1, -1, -1, -1},
+    {1, 6, 2, 1, 7, 6, 1, 8, 7, 1, 4, 8, 1, 5, 4, -1},
+    {1, 2, 10, 4, 9, 5, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 1, 2, 10, 4, 9, 5, 6, 11, 7, -1, -1, -1, -1},
+    {0, 5, 4, 0, 10, 5, 0, 2, 10, 6, 11, 7, -1, -1, -1, -1},
+    {2, 8, 3, 2, 4, 8, 2, 5, 4, 2, 10, 5, 6, 11, 7, -1},
+    {1, 6, 10, 1, 7, 6, 1, 3, 7, 4, 9, 5, -1, -1, -1, -1},
+    {0, 10, 1, 0, 6, 10, 0, 7, 6, 0, 8, 7, 4, 9, 5, -1},
+    {0, 5, 4, 0, 10, 5, 0, 6, 10, 0, 7, 6, 0, 3, 7, -1},
+    {4, 10, 5, 4, 6, 10, 4, 7, 6, 4, 8, 7, -1, -1, -1, -1},
+    {5, 8, 9, 5, 11, 8, 5, 6, 11, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 3, 0, 6, 11, 0, 5, 6, 0, 9, 5, -1, -1, -1, -1},
+    {0, 11, 8, 0, 6, 11, 0, 5, 6, 0, 1, 5, -1, -1, -1, -1},
+    {1, 11, 3, 1, 6, 11, 1, 5, 6, -1, -1, -1, -1, -1, -1, -1},
+    {2, 5, 6, 2, 9, 5, 2, 8, 9, 2, 3, 8, -1, -1, -1, -1},
+    {0, 6, 2, 0, 5, 6, 0, 9, 5, -1, -1, -1, -1, -1, -1, -1},
+    {0, 3, 8, 0, 2, 3, 0, 6, 2, 0, 5, 6, 0, 1, 5, -1},
+    {1, 6, 2, 1, 5, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 2, 10, 5, 8, 9, 5, 11, 8, 5, 6, 11, -1, -1, -1, -1},
+    {0, 11, 3, 0, 6, 11, 0, 5, 6, 0, 9, 5, 1, 2, 10, -1},
+    {0, 11, 8, 0, 6, 11, 0, 5, 6, 0, 10, 5, 0, 2, 10, -1},
+    {2, 11, 3, 2, 6, 11, 2, 5, 6, 2, 10, 5, -1, -1, -1, -1},
+    {1, 6, 10, 1, 5, 6, 1, 9, 5, 1, 8, 9, 1, 3, 8, -1},
+    {0, 10, 1, 0, 6, 10, 0, 5, 6, 0, 9, 5, -1, -1, -1, -1},
+    {0, 3, 8, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 1, 9, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 8, 3, 1, 9, 8, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
+    {2, 3, 11, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 2, 0, 8, 11, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
+    {0, 1, 9, 2, 3, 11, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
+    {1, 11, 2, 1, 8, 11, 1, 9, 8, 5, 10, 6, -1, -1, -1, -1},
+    {1, 6, 5, 1, 2, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 1, 6, 5, 1, 2, 6, -1, -1, -1, -1, -1, -1, -1},
+    {0, 5, 9, 0, 6, 5, 0, 2, 6, -1, -1, -1, -1, -1, -1, -1},
+    {2, 8, 3, 2, 9, 8, 2, 5, 9, 2, 6, 5, -1, -1, -1, -1},
+    {1, 6, 5, 1, 11, 6, 1, 3, 11, -1, -1, -1, -1, -1, -1, -1},
+    {0, 5, 1, 0, 6, 5, 0, 11, 6, 0, 8, 11, -1, -1, -1, -1},
+    {0, 5, 9, 0, 6, 5, 0, 11, 6, 0, 3, 11, -1, -1, -1, -1},
+    {5, 11, 6, 5, 8, 11, 5, 9, 8, -1, -1, -1, -1, -1, -1, -1},
+    {4, 7, 8, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 7, 3, 0, 4, 7, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
+    {0, 1, 9, 4, 7, 8, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
+    {1, 7, 3, 1, 4, 7, 1, 9, 4, 5, 10, 6, -1, -1, -1, -1},
+    {2, 3, 11, 4, 7, 8, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 2, 0, 7, 11, 0, 4, 7, 5, 10, 6, -1, -1, -1, -1},
+    {0, 1, 9, 2, 3, 11, 4, 7, 8, 5, 10, 6, -1, -1, -1, -1},
+    {1, 11, 2, 1, 7, 11, 1, 4, 7, 1, 9, 4, 5, 10, 6, -1},
+    {1, 6, 5, 1, 2, 6, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1},
+    {0, 7, 3, 0, 4, 7, 1, 6, 5, 1, 2, 6, -1, -1, -1, -1},
+    {0, 5, 9, 0, 6, 5, 0, 2, 6, 4, 7, 8, -1, -1, -1, -1},
+    {2, 7, 3, 2, 4, 7, 2, 9, 4, 2, 5, 9, 2, 6, 5, -1},
+    {1, 6, 5, 1, 11, 6, 1, 3, 11, 4, 7, 8, -1, -1, -1, -1},
+    {0, 5, 1, 0, 6, 5, 0, 11, 6, 0, 7, 11, 0, 4, 7, -1},
+    {0, 5, 9, 0, 6, 5, 0, 11, 6, 0, 3, 11, 4, 7, 8, -1},
+    {4, 5, 9, 4, 6, 5, 4, 11, 6, 4, 7, 11, -1, -1, -1, -1},
+    {4, 10, 6, 4, 9, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 4, 10, 6, 4, 9, 10, -1, -1, -1, -1, -1, -1, -1},
+    {0, 6, 4, 0, 10, 6, 0, 1, 10, -1, -1, -1, -1, -1, -1, -1},
+    {1, 8, 3, 1, 4, 8, 1, 6, 4, 1, 10, 6, -1, -1, -1, -1},
+    {2, 3, 11, 4, 10, 6, 4, 9, 10, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 2, 0, 8, 11, 4, 10, 6, 4, 9, 10, -1, -1, -1, -1},
+    {0, 6, 4, 0, 10, 6, 0, 1, 10, 2, 3, 11, -1, -1, -1, -1},
+    {1, 11, 2, 1, 8, 11, 1, 4, 8, 1, 6, 4, 1, 10, 6, -1},
+    {1, 4, 9, 1, 6, 4, 1, 2, 6, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 1, 4, 9, 1, 6, 4, 1, 2, 6, -1, -1, -1, -1},
+    {0, 6, 4, 0, 2, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {2, 8, 3, 2, 4, 8, 2, 6, 4, -1, -1, -1, -1, -1, -1, -1},
+    {1, 4, 9, 1, 6, 4, 1, 11, 6, 1, 3, 11, -1, -1, -1, -1},
+    {0, 9, 1, 0, 4, 9, 0, 6, 4, 0, 11, 6, 0, 8, 11, -1},
+    {0, 6, 4, 0, 11, 6, 0, 3, 11, -1, -1, -1, -1, -1, -1, -1},
+    {4, 11, 6, 4, 8, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {6, 9, 10, 6, 8, 9, 6, 7, 8, -1, -1, -1, -1, -1, -1, -1},
+    {0, 7, 3, 0, 6, 7, 0, 10, 6, 0, 9, 10, -1, -1, -1, -1},
+    {0, 7, 8, 0, 6, 7, 0, 10, 6, 0, 1, 10, -1, -1, -1, -1},
+    {1, 7, 3, 1, 6, 7, 1, 10, 6, -1, -1, -1, -1, -1, -1, -1},
+    {2, 3, 11, 6, 9, 10, 6, 8, 9, 6, 7, 8, -1, -1, -1, -1},
+    {0, 11, 2, 0, 7, 11, 0, 6, 7, 0, 10, 6, 0, 9, 10, -1},
+    {0, 7, 8, 0, 6, 7, 0, 10, 6, 0, 1, 10, 2, 3, 11, -1},
+    {1, 11, 2, 1, 7, 11, 1, 6, 7, 1, 10, 6, -1, -1, -1, -1},
+    {1, 8, 9, 1, 7, 8, 1, 6, 7, 1, 2, 6, -1, -1, -1, -1},
+    {0, 7, 3, 0, 6, 7, 0, 2, 6, 0, 1, 2, 0, 9, 1, -1},
+    {0, 7, 8, 0, 6, 7, 0, 2, 6, -1, -1, -1, -1, -1, -1, -1},
+    {2, 7, 3, 2, 6, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 8, 9, 1, 7, 8, 1, 6, 7, 1, 11, 6, 1, 3, 11, -1},
+    {0, 9, 1, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 7, 8, 0, 6, 7, 0, 11, 6, 0, 3, 11, -1, -1, -1, -1},
+    {6, 7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {5, 11, 7, 5, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 5, 11, 7, 5, 10, 11, -1, -1, -1, -1, -1, -1, -1},
+    {0, 1, 9, 5, 11, 7, 5, 10, 11, -1, -1, -1, -1, -1, -1, -1},
+    {1, 8, 3, 1, 9, 8, 5, 11, 7, 5, 10, 11, -1, -1, -1, -1},
+    {2, 5, 10, 2, 7, 5, 2, 3, 7, -1, -1, -1, -1, -1, -1, -1},
+    {0, 10, 2, 0, 5, 10, 0, 7, 5, 0, 8, 7, -1, -1, -1, -1},
+    {0, 1, 9, 2, 5, 10, 2, 7, 5, 2, 3, 7, -1, -1, -1, -1},
+    {1, 10, 2, 1, 5, 10, 1, 7, 5, 1, 8, 7, 1, 9, 8, -1},
+    {1, 7, 5, 1, 11, 7, 1, 2, 11, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 1, 7, 5, 1, 11, 7, 1, 2, 11, -1, -1, -1, -1},
+    {0, 5, 9, 0, 7, 5, 0, 11, 7, 0, 2, 11, -1, -1, -1, -1},
+    {2, 8, 3, 2, 9, 8, 2, 5, 9, 2, 7, 5, 2, 11, 7, -1},
+    {1, 7, 5, 1, 3, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 5, 1, 0, 7, 5, 0, 8, 7, -1, -1, -1, -1, -1, -1, -1},
+    {0, 5, 9, 0, 7, 5, 0, 3, 7, -1, -1, -1, -1, -1, -1, -1},
+    {5, 8, 7, 5, 9, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 11, 8, 4, 10, 11, 4, 5, 10, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 3, 0, 10, 11, 0, 5, 10, 0, 4, 5, -1, -1, -1, -1},
+    {0, 1, 9, 4, 11, 8, 4, 10, 11, 4, 5, 10, -1, -1, -1, -1},
+    {1, 11, 3, 1, 10, 11, 1, 5, 10, 1, 4, 5, 1, 9, 4, -1},
+    {2, 5, 10, 2, 4, 5, 2, 8, 4, 2, 3, 8, -1, -1, -1, -1},
+    {0, 10, 2, 0, 5, 10, 0, 4, 5, -1, -1, -1, -1, -1, -1, -1},
+    {0, 1, 9, 2, 5, 10, 2, 4, 5, 2, 8, 4, 2, 3, 8, -1},
+    {1, 10, 2, 1, 5, 10, 1, 4, 5, 1, 9, 4, -1, -1, -1, -1},
+    {1, 4, 5, 1, 8, 4, 1, 11, 8, 1, 2, 11, -1, -1, -1, -1},
+    {0, 11, 3, 0, 2, 11, 0, 1, 2, 0, 5, 1, 0, 4, 5, -1},
+    {0, 5, 9, 0, 4, 5, 0, 8, 4, 0, 11, 8, 0, 2, 11, -1},
+    {2, 11, 3, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 4, 5, 1, 8, 4, 1, 3, 8, -1, -1, -1, -1, -1, -1, -1},
+    {0, 5, 1, 0, 4, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 5, 9, 0, 4, 5, 0, 8, 4, 0, 3, 8, -1, -1, -1, -1},
+    {4, 5, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 11, 7, 4, 10, 11, 4, 9, 10, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 3, 4, 11, 7, 4, 10, 11, 4, 9, 10, -1, -1, -1, -1},
+    {0, 7, 4, 0, 11, 7, 0, 10, 11, 0, 1, 10, -1, -1, -1, -1},
+    {1, 8, 3, 1, 4, 8, 1, 7, 4, 1, 11, 7, 1, 10, 11, -1},
+    {2, 9, 10, 2, 4, 9, 2, 7, 4, 2, 3, 7, -1, -1, -1, -1},
+    {0, 10, 2, 0, 9, 10, 0, 4, 9, 0, 7, 4, 0, 8, 7, -1},
+    {0, 7, 4, 0, 3, 7, 0, 2, 3, 0, 10, 2, 0, 1, 10, -1},
+    {1, 10, 2, 4, 8, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 4, 9, 1, 7, 4, 1, 11, 7, 1, 2, 11, -1, -1, -1, -1},
+    {0, 8, 3, 1, 4, 9, 1, 7, 4, 1, 11, 7, 1, 2, 11, -1},
+    {0, 7, 4, 0, 11, 7, 0, 2, 11, -1, -1, -1, -1, -1, -1, -1},
+    {2, 8, 3, 2, 4, 8, 2, 7, 4, 2, 11, 7, -1, -1, -1, -1},
+    {1, 4, 9, 1, 7, 4, 1, 3, 7, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 1, 0, 4, 9, 0, 7, 4, 0, 8, 7, -1, -1, -1, -1},
+    {0, 7, 4, 0, 3, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {8, 10, 11, 8, 9, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 3, 0, 10, 11, 0, 9, 10, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 8, 0, 10, 11, 0, 1, 10, -1, -1, -1, -1, -1, -1, -1},
+    {1, 11, 3, 1, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {2, 9, 10, 2, 8, 9, 2, 3, 8, -1, -1, -1, -1, -1, -1, -1},
+    {0, 10, 2, 0, 9, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 3, 8, 0, 2, 3, 0, 10, 2, 0, 1, 10, -1, -1, -1, -1},
+    {1, 10, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 8, 9, 1, 11, 8, 1, 2, 11, -1, -1, -1, -1, -1, -1, -1},
+    {0, 11, 3, 0, 2, 11, 0, 1, 2, 0, 9, 1, -1, -1, -1, -1},
+    {0, 11, 8, 0, 2, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {2, 11, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 8, 9, 1, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+};
+
+// Function prototypes
+void build_tree(minmax_tree_t *tree, const wervel_field_t *field, const float *values);
+void free_tree(minmax_tree_t *tree);
+long find_active_blocks(const minmax_tree_t *tree, float isovalue, int **blocks);
+void collect_blocks(const minmax_tree_t *tree, int level, int i, int j, int k, float isovalue, int **blocks, long *count, long *capacity);
+void polygonise_block(const wervel_field_t *field, const float *values, int block, const int block_dims[3], float isovalue, triangle_buffer_t *out);
+void polygonise_cell(const wervel_field_t *field, const float *values, int i, int j, int k, float isovalue, triangle_buffer_t *out);
+uint64_t edge_key(long cell, int a, int b, int nx, int ny);
+long find_slot(const long *slots, long num_slots, const uint64_t *edges, uint64_t key);
+long add_vertex(triangle_buffer_t *out, uint64_t key, const double position[3]);
+long merge_vertices(triangle_buffer_t *buffers, int num_threads, float **points);
+void *reallocate(void *pointer, size_t size);
+void write_vtk(const char *path, const float *points, long num_points, const int32_t *triangles, long num_triangles);
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s <wervel.csv> <output.vtk> <column> <isovalue> [isovalue ...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    double start = omp_get_wtime();
+    wervel_field_t field;
+    if (wervel_open(argv[1], &field) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    int column = wervel_column(&field, argv[3]);
+    if (column < 0 && strcmp(argv[3], "magnitude") == 0) {
+        column = wervel_add_column(&field, "magnitude");
+        if (column < 0) {
+            fprintf(stderr, "Memory allocation failed.\n");
+            return EXIT_FAILURE;
+        }
+        const float *vx = field.columns[WERVEL_VX], *vy = field.columns[WERVEL_VY], *vz = field.columns[WERVEL_VZ];
+        float *magnitude = field.columns[column];
+        #pragma omp parallel for simd
+        for (long p = 0; p < field.num_points; p++) {
+            magnitude[p] = sqrtf(vx[p] * vx[p] + vy[p] * vy[p] + vz[p] * vz[p]);
+        }
+    }
+    if (column < 0) {
+        fprintf(stderr, "No column named '%s'.\n", argv[3]);
+        return EXIT_FAILURE;
+    }
+    const float *values = field.columns[column];
+
+    minmax_tree_t tree;
+    build_tree(&tree, &field, values);
+    double prepared = omp_get_wtime();
+    printf("Grid %dx%dx%d, %d tree levels, setup %.6fs\n", field.dims[0], field.dims[1], field.dims[2],
+           tree.num_levels, prepared - start);
+
+    int num_threads = omp_get_max_threads();
+    triangle_buffer_t *buffers = calloc(num_threads, sizeof(triangle_buffer_t));
+    long *first_triangle = malloc((num_threads + 1) * sizeof(long));
+
+    int num_isovalues = argc - 4;
+    for (int n = 0; n < num_isovalues; n++) {
+        float isovalue = (float)atof(argv[4 + n]);
+        double query_start = omp_get_wtime();
+
+        int *blocks = NULL;
+        long num_blocks = find_active_blocks(&tree, isovalue, &blocks);
+        long num_triangles = 0, num_points = 0;
+        float *points = NULL;
+        int32_t *triangles = NULL;
+
+        #pragma omp parallel num_threads(num_threads)
+        {
+            int t = omp_get_thread_num();
+            buffers[t].count = 0;
+            buffers[t].num_vertices = 0;
+            for (long slot = 0; slot < buffers[t].num_slots; slot++) {
+                buffers[t].slots[slot] = -1;
+            }
+
+            #pragma omp for schedule(dynamic)
+            for (long b = 0; b < num_blocks; b++) {
+                polygonise_block(&field, values, blocks[b], tree.levels[0].dims, isovalue, &buffers[t]);
+            }
+
+            // Merge the vertex lists; a prefix sum over the per-thread counts
+            // gives each thread its output offset for the triangles
+            #pragma omp single
+            {
+                num_points = merge_vertices(buffers, num_threads, &points);
+                first_triangle[0] = 0;
+                for (int u = 0; u < num_threads; u++) {
+                    first_triangle[u + 1] = first_triangle[u] + buffers[u].count;
+                }
+                num_triangles = first_triangle[num_threads];
+                triangles = reallocate(NULL, (num_triangles * 3 + 1) * sizeof(int32_t));
+            }
+
+            int32_t *dst = triangles + first_triangle[t] * 3;
+            for (long v = 0; v < buffers[t].count * 3; v++) {
+                dst[v] = (int32_t)buffers[t].merged[buffers[t].triangles[v]];
+            }
+        }
+        double query_end = omp_get_wtime();
+
+        char path[4096];
+        if (num_isovalues == 1) {
+            snprintf(path, sizeof(path), "%s", argv[2]);
+        } else {
+            const char *dot = strrchr(argv[2], '.');
+            int stem = dot != NULL ? (int)(dot - argv[2]) : (int)strlen(argv[2]);
+            snprintf(path, sizeof(path), "%.*s_%03d%s", stem, argv[2], n, dot != NULL ? dot : ".vtk");
+        }
+        write_vtk(path, points, num_points, triangles, num_triangles);
+
+        printf("Isovalue %g: %ld of %d blocks active, %ld triangles, %ld points in %.6fs -> %s\n", isovalue, num_blocks,
+               tree.levels[0].dims[0] * tree.levels[0].dims[1] * tree.levels[0].dims[2], num_triangles, num_points,
+               query_end - query_start, path);
+        free(points);
+        free(triangles);
+        free(blocks);
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        free(buffers[t].points);
+        free(buffers[t].edges);
+        free(buffers[t].merged);
+        free(buffers[t].slots);
+        free(buffers[t].triangles);
+    }
+    free(buffers);
+    free(first_triangle);
+    free_tree(&tree);
+    wervel_free(&field);
+    return EXIT_SUCCESS;
+}
+
+// Build the min/max tree: per-block ranges, then 2x2x2 reductions up to a single root
+void build_tree(minmax_tree_t *tree, const wervel_field_t *field, const float *values) {
+    const int nx = field->dims[0], ny = field->dims[1], nz = field->dims[2];
+    int cells[3] = {nx > 1 ? nx - 1 : 1, ny > 1 ? ny - 1 : 1, nz > 1 ? nz - 1 : 1};
+
+    int max_levels = 1;
+    for (int size = BLOCK; size < cells[0] || size < cells[1] || size < cells[2]; size *= 2) {
+        max_levels++;
+    }
+    tree->levels = calloc(max_levels, sizeof(tree_level_t));
+    tree->num_levels = max_levels;
+
+    tree_level_t *leaf = &tree->levels[0];
+    for (int a = 0; a < 3; a++) {
+        leaf->dims[a] = (cells[a] + BLOCK - 1) / BLOCK;
+    }
+    long num_blocks = (long)leaf->dims[0] * leaf->dims[1] * leaf->dims[2];
+    leaf->min = malloc(num_blocks * sizeof(float));
+    leaf->max = malloc(num_blocks * sizeof(float));
+
+    // A block of cells touches the points one past its last cell as well
+    #pragma omp parallel for schedule(dynamic)
+    for (long b = 0; b < num_blocks; b++) {
+        int bi = b % leaf->dims[0], bj = (b / leaf->dims[0]) % leaf->dims[1], bk = b / ((long)leaf->dims[0] * leaf->dims[1]);
+        int i1 = (bi + 1) * BLOCK < nx - 1 ? (bi + 1) * BLOCK : nx - 1;
+        int j1 = (bj + 1) * BLOCK < ny - 1 ? (bj + 1) * BLOCK : ny - 1;
+        int k1 = (bk + 1) * BLOCK < nz - 1 ? (bk + 1) * BLOCK : nz - 1;
+        float lo = INFINITY, hi = -INFINITY;
+        for (int k = bk * BLOCK; k <= k1; k++) {
+            for (int j = bj * BLOCK; j <= j1; j++) {
+                const float *row = values + ((long)k * ny + j) * nx;
+                for (int i = bi * BLOCK; i <= i1; i++) {
+                    lo = fminf(lo, row[i]);
+                    hi = fmaxf(hi, row[i]);
+                }
+            }
+        }
+        leaf->min[b] = lo;
+        leaf->max[b] = hi;
+    }
+
+    for (int l = 1; l < max_levels; l++) {
+        tree_level_t *below = &tree->levels[l - 1];
+        tree_level_t *level = &tree->levels[l];
+        for (int a = 0; a < 3; a++) {
+            level->dims[a] = (below->dims[a] + 1) / 2;
+        }
+        long count = (long)level->dims[0] * level->dims[1] * level->dims[2];
+        level->min = malloc(count * sizeof(float));
+        level->max = malloc(count * sizeof(float));
+
+        #pragma omp parallel for
+        for (long n = 0; n < count; n++) {
+            int i = n % level->dims[0], j = (n / level->dims[0]) % level->dims[1], k = n / ((long)level->dims[0] * level->dims[1]);
+            float lo = INFINITY, hi = -INFINITY;
+            for (int c = 0; c < 8; c++) {
+                int ci = 2 * i + (c & 1), cj = 2 * j + ((c >> 1) & 1), ck = 2 * k + (c >> 2);
+                if (ci < below->dims[0] && cj < below->dims[1] && ck < below->dims[2]) {
+                    long child = ((long)ck * below->dims[1] + cj) * below->dims[0] + ci;
+                    lo = fminf(lo, below->min[child]);
+                    hi = fmaxf(hi, below->max[child]);
+                }
+            }
+            level->min[n] = lo;
+            level->max[n] = hi;
+        }
+    }
+}
+
+// Free the tree
+void free_tree(minmax_tree_t *tree) {
+    for (int l = 0; l < tree->num_levels; l++) {
+        free(tree->levels[l].min);
+        free(tree->levels[l].max);
+    }
+    free(tree->levels);
+}
+
+// List the blocks whose range contains the isovalue
+long find_active_blocks(const minmax_tree_t *tree, float isovalue, int **blocks) {
+    long count = 0, capacity = 0;
+    const tree_level_t *top = &tree->levels[tree->num_levels - 1];
+    for (int k = 0; k < top->dims[2]; k++) {
+        for (int j = 0; j < top->dims[1]; j++) {
+            for (int i = 0; i < top->dims[0]; i++) {
+                collect_blocks(tree, tree->num_levels - 1, i, j, k, isovalue, blocks, &count, &capacity);
+            }
+        }
+    }
+    return count;
+}
+
+// Descend into the children of a node whose range contains the isovalue
+void collect_blocks(const minmax_tree_t *tree, int level, int i, int j, int k, float isovalue, int **blocks, long *count, long *capacity) {
+    const tree_level_t *node = &tree->levels[level];
+    if (i >= node->dims[0] || j >= node->dims[1] || k >= node->dims[2]) {
+        return;
+    }
+    long n = ((long)k * node->dims[1] + j) * node->dims[0] + i;
+    if (isovalue < node->min[n] || isovalue > node->max[n]) {
+        return;
+    }
+
+    if (level == 0) {
+        if (*count == *capacity) {
+            *capacity = *capacity ? 2 * *capacity : 256;
+            *blocks = realloc(*blocks, *capacity * sizeof(int));
+            if (*blocks == NULL) {
+                fprintf(stderr, "Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        (*blocks)[(*count)++] = (int)n;
+        return;
+    }
+    for (int c = 0; c < 8; c++) {
+        collect_blocks(tree, level - 1, 2 * i + (c & 1), 2 * j + ((c >> 1) & 1), 2 * k + (c >> 2), isovalue, blocks, count, capacity);
+    }
+}
+
+// Triangulate the surface inside one block of cells
+void polygonise_block(const wervel_field_t *field, const float *values, int block, const int block_dims[3], float isovalue, triangle_buffer_t *out) {
+    const int nx = field->dims[0], ny = field->dims[1], nz = field->dims[2];
+    if (nx < 2 || ny < 2 || nz < 2) {
+        return;
+    }
+
+    int bi = block % block_dims[0], bj = (block / block_dims[0]) % block_dims[1], bk = block / (block_dims[0] * block_dims[1]);
+    int i1 = (bi + 1) * BLOCK < nx - 1 ? (bi + 1) * BLOCK : nx - 1;
+    int j1 = (bj + 1) * BLOCK < ny - 1 ? (bj + 1) * BLOCK : ny - 1;
+    int k1 = (bk + 1) * BLOCK < nz - 1 ? (bk + 1) * BLOCK : nz - 1;
+
+    for (int k = bk * BLOCK; k < k1; k++) {
+        for (int j = bj * BLOCK; j < j1; j++) {
+            for (int i = bi * BLOCK; i < i1; i++) {
+                polygonise_cell(field, values, i, j, k, isovalue, out);
+            }
+        }
+    }
+}
+
+// Marching cubes on the cell with lowest corner (i, j, k)
+void polygonise_cell(const wervel_field_t *field, const float *values, int i, int j, int k, float isovalue, triangle_buffer_t *out) {
+    const int nx = field->dims[0], ny = field->dims[1];
+    long cell = ((long)k * ny + j) * nx + i;
+    double f[8];
+    int index = 0;
+    for (int c = 0; c < 8; c++) {
+        f[c] = values[cell + (c & 1) + ((c >> 1) & 1) * (long)nx + (c >> 2) * (long)nx * ny];
+        index |= (f[c] >= isovalue) << c;
+    }
+    int crossed = edge_table[index];
+    if (crossed == 0) {
+        return;
+    }
+
+    // Crossing point on every crossed edge, always interpolated from its
+    // lower corner so neighbouring cells find the same point
+    long vertices[12];
+    for (int e = 0; e < 12; e++) {
+        if (!(crossed & (1 << e))) {
+            continue;
+        }
+        int low = cube_edges[e][0] & cube_edges[e][1], high = cube_edges[e][0] | cube_edges[e][1];
+        double t = (isovalue - f[low]) / (f[high] - f[low]);
+        double position[3] = {
+            field->origin[0] + (i + (low & 1) + t * ((high & 1) - (low & 1))) * field->spacing[0],
+            field->origin[1] + (j + ((low >> 1) & 1) + t * (((high >> 1) & 1) - ((low >> 1) & 1))) * field->spacing[1],
+            field->origin[2] + (k + (low >> 2) + t * ((high >> 2) - (low >> 2))) * field->spacing[2],
+        };
+        vertices[e] = add_vertex(out, edge_key(cell, low, high, nx, ny), position);
+    }
+
+    for (int n = 0; triangle_table[index][n] >= 0; n += 3) {
+        if (out->count == out->capacity) {
+            out->capacity = out->capacity ? 2 * out->capacity : 1024;
+            out->triangles = reallocate(out->triangles, out->capacity * 3 * sizeof(int32_t));
+        }
+        int32_t *dst = out->triangles + out->count * 3;
+        for (int v = 0; v < 3; v++) {
+            dst[v] = (int32_t)vertices[triangle_table[index][n + v]];
+        }
+        out->count++;
+    }
+}
+
+// Key of the grid edge between corners a and b of a cell. The corners of a
+// cube edge differ in one +x/+y/+z bit, so the edge is its lower grid point
+// and the bit it adds; every cell sharing the edge computes the same key.
+uint64_t edge_key(long cell, int a, int b, int nx, int ny) {
+    int low = a & b;
+    long point = cell + (low & 1) + ((low >> 1) & 1) * (long)nx + (low >> 2) * (long)nx * ny;
+    return (uint64_t)point * 8 + (uint64_t)(a ^ b);
+}
+
+// Slot of key in an open addressing table of vertex numbers, or the free slot where it belongs
+long find_slot(const long *slots, long num_slots, const uint64_t *edges, uint64_t key) {
+    long slot = (long)((key * 0x9e3779b97f4a7c15ULL) >> 20) & (num_slots - 1);
+    while (slots[slot] >= 0 && edges[slots[slot]] != key) {
+        slot = (slot + 1) & (num_slots - 1);
+    }
+    return slot;
+}
+
+// Vertex number of the crossing on an edge, adding it if this thread has not seen it yet
+long add_vertex(triangle_buffer_t *out, uint64_t key, const double position[3]) {
+    // Keep the table at most half full
+    if (2 * (out->num_vertices + 1) > out->num_slots) {
+        out->num_slots = out->num_slots ? 2 * out->num_slots : 4096;
+        out->slots = reallocate(out->slots, out->num_slots * sizeof(long));
+        memset(out->slots, 0xff, out->num_slots * sizeof(long));
+        for (long n = 0; n < out->num_vertices; n++) {
+            out->slots[find_slot(out->slots, out->num_slots, out->edges, out->edges[n])] = n;
+        }
+    }
+
+    long slot = find_slot(out->slots, out->num_slots, out->edges, key);
+    if (out->slots[slot] >= 0) {
+        return out->slots[slot];
+    }
+    if (out->num_vertices == out->vertex_capacity) {
+        out->vertex_capacity = out->vertex_capacity ? 2 * out->vertex_capacity : 1024;
+        out->points = reallocate(out->points, out->vertex_capacity * 3 * sizeof(float));
+        out->edges = reallocate(out->edges, out->vertex_capacity * sizeof(uint64_t));
+        out->merged = reallocate(out->merged, out->vertex_capacity * sizeof(long));
+    }
+    long n = out->num_vertices++;
+    for (int d = 0; d < 3; d++) {
+        out->points[3 * n + d] = (float)position[d];
+    }
+    out->edges[n] = key;
+    out->slots[slot] = n;
+    return n;
+}
+
+// Number the vertices of all threads, keeping one per edge; fills every
+// buffer's merged numbers and returns the number of points
+long merge_vertices(triangle_buffer_t *buffers, int num_threads, float **points) {
+    long total = 0;
+    for (int t = 0; t < num_threads; t++) {
+        total += buffers[t].num_vertices;
+    }
+    long num_slots = 1;
+    while (num_slots < 2 * total) {
+        num_slots *= 2;
+    }
+    long *slots = reallocate(NULL, num_slots * sizeof(long));
+    uint64_t *edges = reallocate(NULL, (total + 1) * sizeof(uint64_t));
+    *points = reallocate(NULL, (total * 3 + 1) * sizeof(float));
+    memset(slots, 0xff, num_slots * sizeof(long));
+
+    long count = 0;
+    for (int t = 0; t < num_threads; t++) {
+        for (long n = 0; n < buffers[t].num_vertices; n++) {
+            long slot = find_slot(slots, num_slots, edges, buffers[t].edges[n]);
+            if (slots[slot] < 0) {
+                slots[slot] = count;
+                edges[count] = buffers[t].edges[n];
+                memcpy(*points + 3 * count, buffers[t].points + 3 * n, 3 * sizeof(float));
+                count++;
+            }
+            buffers[t].merged[n] = slots[slot];
+        }
+    }
+    free(slots);
+    free(edges);
+    return count;
+}
+
+// realloc that gives up on failure
+void *reallocate(void *pointer, size_t size) {
+    pointer = realloc(pointer, size);
+    if (pointer == NULL) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    return pointer;
+}
+
+// Write the indexed triangles as binary legacy VTK polydata
+void write_vtk(const char *path, const float *points, long num_points, const int32_t *triangles, long num_triangles) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Cannot write %s.\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(file, "# vtk DataFile Version 3.0\nwervel isosurface\nBINARY\nDATASET POLYDATA\n");
+    fprintf(file, "POINTS %ld float\n", num_points);
+    wervel_write_big_endian(file, points, 3 * num_points);
+
+    fprintf(file, "\nPOLYGONS %ld %ld\n", num_triangles, 4 * num_triangles);
+    for (long t = 0; t < num_triangles; t++) {
+        int32_t cell[4] = {3, triangles[3 * t], triangles[3 * t + 1], triangles[3 * t + 2]};
+        wervel_write_big_endian(file, cell, 4);
+    }
+    fprintf(file, "\n");
+    fclose(file);
+}
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+#include "wervel.h"
+#include "spatial_index.h"
+
+// Probe the wervel field at random points through the spatial index
+//
+// Usage: probe <wervel.csv> [probes] [seed]
+//
+// Both index types are built over the sample points: the lattice index that
+// wervel.csv gets, and the k-d tree a scattered data set would get. Every
+// probe is then located and matched to its nearest sample with the batched
+// queries, the two indexes are checked against each other and against a brute
+// force search on the first probes, and the timings are printed.
+
+#define DEFAULT_PROBES 100000
+#define BRUTE_FORCE_PROBES 200
+
+double random_between(unsigned int *state, double lo, double hi);
+long brute_force_nearest(const wervel_field_t *field, const double p[3], double *distance2);
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "Usage: %s <wervel.csv> [probes] [seed]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    long num_probes = argc > 2 ? atol(argv[2]) : DEFAULT_PROBES;
+    unsigned int seed = argc > 3 ? (unsigned int)atoi(argv[3]) : 1;
+    if (num_probes < 1) {
+        fprintf(stderr, "Need at least one probe.\n");
+        return EXIT_FAILURE;
+    }
+
+    wervel_field_t field;
+    if (wervel_open(argv[1], &field) != 0) {
+        return EXIT_FAILURE;
+    }
+    const float *x = field.columns[WERVEL_X], *y = field.columns[WERVEL_Y], *z = field.columns[WERVEL_Z];
+
+    double start = omp_get_wtime();
+    spatial_index_t lattice;
+    if (spatial_index_build(&lattice, x, y, z, field.num_points, 0) != 0) {
+        fprintf(stderr, "Could not build the lattice index.\n");
+        return EXIT_FAILURE;
+    }
+    double lattice_build = omp_get_wtime() - start;
+
+    start = omp_get_wtime();
+    spatial_index_t tree;
+    if (spatial_index_build(&tree, x, y, z, field.num_points, 1) != 0) {
+        fprintf(stderr, "Could not build the k-d tree.\n");
+        return EXIT_FAILURE;
+    }
+    double tree_build = omp_get_wtime() - start;
+
+    // Random probes in the bounding box, with a margin outside it
+    double *px = malloc(num_probes * sizeof(double));
+    double *py = malloc(num_probes * sizeof(double));
+    double *pz = malloc(num_probes * sizeof(double));
+    long *cells = malloc(num_probes * sizeof(long));
+    long *lattice_nearest = malloc(num_probes * sizeof(long));
+    long *tree_nearest = malloc(num_probes * sizeof(long));
+    double *lattice_d2 = malloc(num_probes * sizeof(double));
+    double *tree_d2 = malloc(num_probes * sizeof(double));
+    if (px == NULL || py == NULL || pz == NULL || cells == NULL || lattice_nearest == NULL || tree_nearest == NULL ||
+        lattice_d2 == NULL || tree_d2 == NULL) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return EXIT_FAILURE;
+    }
+    double *probe[3] = {px, py, pz};
+    for (int a = 0; a < 3; a++) {
+        double margin = field.spacing[a];
+        double hi = field.origin[a] + (field.dims[a] - 1) * field.spacing[a];
+        for (long q = 0; q < num_probes; q++) {
+            probe[a][q] = random_between(&seed, field.origin[a] - margin, hi + margin);
+        }
+    }
+
+    start = omp_get_wtime();
+    spatial_locate_batch(&lattice, num_probes, px, py, pz, cells);
+    double locate_time = omp_get_wtime() - start;
+
+    start = omp_get_wtime();
+    spatial_nearest_batch(&lattice, num_probes, px, py, pz, lattice_nearest, lattice_d2);
+    double lattice_time = omp_get_wtime() - start;
+
+    start = omp_get_wtime();
+    spatial_nearest_batch(&tree, num_probes, px, py, pz, tree_nearest, tree_d2);
+    double tree_time = omp_get_wtime() - start;
+
+    // Ties may pick different samples, so compare distances
+    long inside = 0, mismatches = 0;
+    for (long q = 0; q < num_probes; q++) {
+        inside += cells[q] >= 0;
+        mismatches += fabs(lattice_d2[q] - tree_d2[q]) > 1e-6 * (1.0 + lattice_d2[q]);
+    }
+
+    long brute_probes = num_probes < BRUTE_FORCE_PROBES ? num_probes : BRUTE_FORCE_PROBES;
+    start = omp_get_wtime();
+    for (long q = 0; q < brute_probes; q++) {
+        double p[3] = {px[q], py[q], pz[q]}, d2;
+        brute_force_nearest(&field, p, &d2);
+        mismatches += fabs(d2 - tree_d2[q]) > 1e-6 * (1.0 + d2);
+    }
+    double brute_time = (omp_get_wtime() - start) / brute_probes * num_probes;
+
+    double p[3] = {px[0], py[0], pz[0]};
+    long neighbours = spatial_within(&tree, p, 2.0 * field.spacing[0], NULL, 0);
+
+    printf("Grid %dx%dx%d (%ld points), %ld probes, %d threads\n", field.dims[0], field.dims[1], field.dims[2],
+           field.num_points, num_probes, omp_get_max_threads());
+    printf("Lattice detected: %s\n", lattice.structured ? "yes" : "no");
+    printf("Build:   lattice %.6fs, k-d tree %.6fs\n", lattice_build, tree_build);
+    printf("Locate:  %.6fs, %ld probes inside the grid\n", locate_time, inside);
+    printf("Nearest: lattice %.6fs, k-d tree %.6fs, brute force ~%.6fs (extrapolated)\n", lattice_time, tree_time, brute_time);
+    printf("Samples within two cells of the first probe: %ld\n", neighbours);
+    printf("Mismatches: %ld\n", mismatches);
+
+    free(px);
+    free(py);
+    free(pz);
+    free(cells);
+    free(lattice_nearest);
+    free(tree_nearest);
+    free(lattice_d2);
+    free(tree_d2);
+    spatial_index_free(&lattice);
+    spatial_index_free(&tree);
+    wervel_free(&field);
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Uniform random number in [lo, hi)
+double random_between(unsigned int *state, double lo, double hi) {
+    return lo + (hi - lo) * (rand_r(state) / ((double)RAND_MAX + 1.0));
+}
+
+// Nearest sample by checking every point
+long brute_force_nearest(const wervel_field_t *field, const double p[3], double *distance2) {
+    const float *x = field->columns[WERVEL_X], *y = field->columns[WERVEL_Y], *z = field->columns[WERVEL_Z];
+    long best = -1;
+    double best_d2 = INFINITY;
+    for (long i = 0; i < field->num_points; i++) {
+        double dx = p[0] - x[i], dy = p[1] - y[i], dz = p[2] - z[i];
+        double d2 = dx * dx + dy * dy + dz * dz;
+        if (d2 < best_d2) {
+            best_d2 = d2;
+            best = i;
+        }
+    }
+    *distance2 = best_d2;
+    return best;
+}
@@ -0,0 +1,512 @@
+/* File: spatial_index.h */
+
+// Point location and neighbour queries over the sample points of a field.
+//
+// If the points form a regular lattice (as in wervel.csv) the index is a
+// uniform grid: a query is turned into lattice coordinates arithmetically and
+// a small table maps lattice slots back to the caller's point numbers. Any
+// other point set gets a k-d tree laid out implicitly in breadth-first
+// (Eytzinger) order: the children of node i are nodes 2i + 1 and 2i + 2, and
+// a node at depth d splits on axis d % 3. The tree is complete, so n points
+// fill exactly slots [0, n) with no child pointers, and the top levels every
+// query walks sit together at the front of the arrays. Coordinates are
+// stored in node order, one array per axis. Searches keep, with every
+// deferred subtree, the squared distance to its splitting plane, and skip it
+// once a closer point has been found.
+//
+// The batch queries split the probes over the OpenMP threads. On a lattice a
+// query is a few arithmetic operations, so the probes are answered in the
+// caller's order. On a k-d tree they are first sorted along a Morton curve
+// with a parallel radix sort, so probes that are close in space walk the same
+// nodes one after the other and reuse the same cache lines. Results are
+// written back in the caller's order.
+
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <omp.h>
+
+#define SPATIAL_MAX_DEPTH 64
+#define SPATIAL_TASK_CUTOFF 4096
+#define SPATIAL_RADIX_BITS 8 // Bits of the Morton code sorted per pass
+#define SPATIAL_RADIX (1 << SPATIAL_RADIX_BITS)
+
+typedef struct {
+    int structured;
+    long num_points;
+
+    // Uniform grid for lattices
+    int dims[3];
+    double origin[3];
+    double spacing[3];
+    long *lattice_ids; // Point number at every lattice slot
+
+    // Implicit k-d tree for scattered points
+    float *coords[3];  // Coordinates in tree order
+    long *ids;         // Point number at every tree slot
+} spatial_index_t;
+
+// Probe number with its Morton code, for sorting
+typedef struct {
+    uint64_t code;
+    long probe;
+} spatial_order_t;
+
+// Try to treat the points as a regular lattice; returns 0 if they are not one
+static inline int spatial_build_lattice(spatial_index_t *index, const float *x, const float *y, const float *z, long n) {
+    const float *axis[3] = {x, y, z};
+    long slots = 1;
+    for (int a = 0; a < 3; a++) {
+        double lo = axis[a][0], hi = axis[a][0], step = INFINITY;
+        #pragma omp parallel for reduction(min : lo) reduction(max : hi)
+        for (long p = 0; p < n; p++) {
+            lo = axis[a][p] < lo ? axis[a][p] : lo;
+            hi = axis[a][p] > hi ? axis[a][p] : hi;
+        }
+        #pragma omp parallel for reduction(min : step)
+        for (long p = 0; p < n; p++) {
+            double offset = axis[a][p] - lo;
+            if (offset > 1e-6 && offset < step) {
+                step = offset;
+            }
+        }
+        index->origin[a] = lo;
+        index->spacing[a] = isinf(step) ? 1.0 : step;
+        index->dims[a] = (int)lround((hi - lo) / index->spacing[a]) + 1;
+        slots *= index->dims[a];
+    }
+    if (slots != n) {
+        return 0;
+    }
+
+    index->lattice_ids = malloc(n * sizeof(long));
+    atomic_uchar *filled = calloc(n, sizeof(atomic_uchar));
+    if (index->lattice_ids == NULL || filled == NULL) {
+        free(index->lattice_ids);
+        index->lattice_ids = NULL;
+        free(filled);
+        return 0;
+    }
+
+    // Every point has to land exactly on its own slot; with as many points
+    // as slots, no slot claimed twice also means every slot is filled
+    int on_lattice = 1;
+    #pragma omp parallel for reduction(& : on_lattice)
+    for (long p = 0; p < n; p++) {
+        long slot = 0;
+        int inside = 1;
+        for (int a = 2; a >= 0; a--) {
+            double g = (axis[a][p] - index->origin[a]) / index->spacing[a];
+            long k = lround(g);
+            inside &= fabs(g - k) < 1e-3 && k >= 0 && k < index->dims[a];
+            slot = slot * index->dims[a] + k;
+        }
+        if (inside && atomic_exchange_explicit(&filled[slot], 1, memory_order_relaxed) == 0) {
+            index->lattice_ids[slot] = p;
+        } else {
+            on_lattice = 0;
+        }
+    }
+    free(filled);
+    if (!on_lattice) {
+        free(index->lattice_ids);
+        index->lattice_ids = NULL;
+    }
+    return on_lattice;
+}
+
+// Partially sort slots [lo, hi) of ids so the split point on an axis ends up at mid
+static inline void spatial_select(long *ids, const float *key, long lo, long hi, long mid) {
+    while (hi - lo > 1) {
+        float pivot = key[ids[lo + (hi - lo) / 2]];
+        long i = lo, j = hi - 1;
+        while (i <= j) {
+            while (key[ids[i]] < pivot) i++;
+            while (key[ids[j]] > pivot) j--;
+            if (i <= j) {
+                long t = ids[i];
+                ids[i] = ids[j];
+                ids[j] = t;
+                i++;
+                j--;
+            }
+        }
+        if (mid <= j) {
+            hi = j + 1;
+        } else if (mid >= i) {
+            lo = i;
+        } else {
+            return;
+        }
+    }
+}
+
+// Size of the left subtree of a complete binary tree with n nodes
+static inline long spatial_left_size(long n) {
+    long half = 1; // Nodes on the last full level of the left subtree
+    while (4 * half - 1 <= n) {
+        half *= 2;
+    }
+    long rest = n - (2 * half - 1); // Nodes on the partial bottom level
+    return half - 1 + (rest < half ? rest : half);
+}
+
+// Put the points in slots [lo, hi) of order into the subtree rooted at node:
+// the split point goes to the node and the points on either side of it to
+// its children. Subtrees become tasks.
+static inline void spatial_build_tree(spatial_index_t *index, long *order, const float *axis[3], long lo, long hi, long node, int depth) {
+    if (hi <= lo) {
+        return;
+    }
+    long mid = lo + spatial_left_size(hi - lo);
+    spatial_select(order, axis[depth % 3], lo, hi, mid);
+    index->ids[node] = order[mid];
+    for (int a = 0; a < 3; a++) {
+        index->coords[a][node] = axis[a][order[mid]];
+    }
+
+    #pragma omp task if (hi - lo > SPATIAL_TASK_CUTOFF)
+    spatial_build_tree(index, order, axis, lo, mid, 2 * node + 1, depth + 1);
+    #pragma omp task if (hi - lo > SPATIAL_TASK_CUTOFF)
+    spatial_build_tree(index, order, axis, mid + 1, hi, 2 * node + 2, depth + 1);
+    #pragma omp taskwait
+}
+
+// Build an index over n points; force_tree skips the lattice check
+static inline int spatial_index_build(spatial_index_t *index, const float *x, const float *y, const float *z, long n, int force_tree) {
+    index->num_points = n;
+    index->lattice_ids = NULL;
+    index->ids = NULL;
+    for (int a = 0; a < 3; a++) {
+        index->coords[a] = NULL;
+    }
+    if (n < 1) {
+        return -1;
+    }
+
+    index->structured = !force_tree && spatial_build_lattice(index, x, y, z, n);
+    if (index->structured) {
+        return 0;
+    }
+
+    long *order = malloc(n * sizeof(long));
+    index->ids = malloc(n * sizeof(long));
+    for (int a = 0; a < 3; a++) {
+        index->coords[a] = malloc(n * sizeof(float));
+    }
+    if (order == NULL || index->ids == NULL || index->coords[0] == NULL || index->coords[1] == NULL || index->coords[2] == NULL) {
+        free(order);
+        return -1;
+    }
+    #pragma omp parallel for
+    for (long p = 0; p < n; p++) {
+        order[p] = p;
+    }
+
+    const float *axis[3] = {x, y, z};
+    #pragma omp parallel
+    #pragma omp single
+    spatial_build_tree(index, order, axis, 0, n, 0, 0);
+    free(order);
+    return 0;
+}
+
+// Free an index
+static inline void spatial_index_free(spatial_index_t *index) {
+    free(index->lattice_ids);
+    free(index->ids);
+    for (int a = 0; a < 3; a++) {
+        free(index->coords[a]);
+    }
+}
+
+// Nearest point to p in the k-d tree; returns its point number and squared distance
+static inline long spatial_tree_nearest(const spatial_index_t *index, const double p[3], double *distance2) {
+    // bound is the squared distance from p to the splitting planes that
+    // separate it from the subtree, a lower bound for any point in it
+    struct { long node; int depth; double bound; } stack[SPATIAL_MAX_DEPTH * 2];
+    int top = 0;
+    long best = -1;
+    double best_d2 = INFINITY;
+    stack[top].node = 0, stack[top].depth = 0, stack[top].bound = 0.0, top++;
+
+    while (top > 0) {
+        top--;
+        long node = stack[top].node;
+        int depth = stack[top].depth;
+        double bound = stack[top].bound;
+        if (node >= index->num_points || bound >= best_d2) {
+            continue;
+        }
+
+        double dx = p[0] - index->coords[0][node], dy = p[1] - index->coords[1][node], dz = p[2] - index->coords[2][node];
+        double d2 = dx * dx + dy * dy + dz * dz;
+        if (d2 < best_d2) {
+            best_d2 = d2;
+            best = node;
+        }
+
+        // Push the far side first so the near side is searched first
+        int a = depth % 3;
+        double diff = p[a] - index->coords[a][node];
+        long near = diff < 0 ? 2 * node + 1 : 2 * node + 2, far = diff < 0 ? 2 * node + 2 : 2 * node + 1;
+        double far_bound = diff * diff > bound ? diff * diff : bound;
+        if (far_bound < best_d2) {
+            stack[top].node = far, stack[top].depth = depth + 1, stack[top].bound = far_bound, top++;
+        }
+        stack[top].node = near, stack[top].depth = depth + 1, stack[top].bound = bound, top++;
+    }
+    *distance2 = best_d2;
+    return index->ids[best];
+}
+
+// Nearest sample to a single point
+static inline long spatial_nearest(const spatial_index_t *index, const double p[3], double *distance2) {
+    if (!index->structured) {
+        return spatial_tree_nearest(index, p, distance2);
+    }
+
+    // On a lattice the nearest sample is the rounded, clamped lattice position
+    long slot = 0;
+    double d2 = 0.0;
+    for (int a = 2; a >= 0; a--) {
+        long k = lround((p[a] - index->origin[a]) / index->spacing[a]);
+        k = k < 0 ? 0 : k >= index->dims[a] ? index->dims[a] - 1 : k;
+        double d = p[a] - (index->origin[a] + k * index->spacing[a]);
+        d2 += d * d;
+        slot = slot * index->dims[a] + k;
+    }
+    *distance2 = d2;
+    return index->lattice_ids[slot];
+}
+
+// Cell of a lattice containing a point, numbered i + (nx - 1) * (j + (ny - 1) * k),
+// or -1 if the point is outside the grid or the points are not a lattice
+static inline long spatial_locate(const spatial_index_t *index, const double p[3]) {
+    if (!index->structured) {
+        return -1;
+    }
+    long cell = 0;
+    for (int a = 2; a >= 0; a--) {
+        double g = (p[a] - index->origin[a]) / index->spacing[a];
+        int cells = index->dims[a] > 1 ? index->dims[a] - 1 : 1;
+        if (g < 0.0 || g > index->dims[a] - 1) {
+            return -1;
+        }
+        long k = (long)g;
+        k = k >= cells ? cells - 1 : k;
+        cell = cell * cells + k;
+    }
+    return cell;
+}
+
+// Number of samples within radius of p, storing up to max_ids of them
+static inline long spatial_within(const spatial_index_t *index, const double p[3], double radius, long *ids, long max_ids) {
+    long found = 0;
+    double r2 = radius * radius;
+
+    if (index->structured) {
+        // Scan the lattice box around p
+        long lo[3], hi[3];
+        for (int a = 0; a < 3; a++) {
+            lo[a] = (long)ceil((p[a] - radius - index->origin[a]) / index->spacing[a]);
+            hi[a] = (long)floor((p[a] + radius - index->origin[a]) / index->spacing[a]);
+            lo[a] = lo[a] < 0 ? 0 : lo[a];
+            hi[a] = hi[a] >= index->dims[a] ? index->dims[a] - 1 : hi[a];
+        }
+        for (long k = lo[2]; k <= hi[2]; k++) {
+            for (long j = lo[1]; j <= hi[1]; j++) {
+                for (long i = lo[0]; i <= hi[0]; i++) {
+                    double dx = p[0] - (index->origin[0] + i * index->spacing[0]);
+                    double dy = p[1] - (index->origin[1] + j * index->spacing[1]);
+                    double dz = p[2] - (index->origin[2] + k * index->spacing[2]);
+                    if (dx * dx + dy * dy + dz * dz <= r2) {
+                        if (found < max_ids) {
+                            ids[found] = index->lattice_ids[(k * index->dims[1] + j) * index->dims[0] + i];
+                        }
+                        found++;
+                    }
+                }
+            }
+        }
+        return found;
+    }
+
+    // bound as in spatial_tree_nearest
+    struct { long node; int depth; double bound; } stack[SPATIAL_MAX_DEPTH * 2];
+    int top = 0;
+    stack[top].node = 0, stack[top].depth = 0, stack[top].bound = 0.0, top++;
+    while (top > 0) {
+        top--;
+        long node = stack[top].node;
+        int depth = stack[top].depth;
+        double bound = stack[top].bound;
+        if (node >= index->num_points || bound > r2) {
+            continue;
+        }
+        double dx = p[0] - index->coords[0][node], dy = p[1] - index->coords[1][node], dz = p[2] - index->coords[2][node];
+        if (dx * dx + dy * dy + dz * dz <= r2) {
+            if (found < max_ids) {
+                ids[found] = index->ids[node];
+            }
+            found++;
+        }
+        int a = depth % 3;
+        double diff = p[a] - index->coords[a][node];
+        double far_bound = diff * diff > bound ? diff * diff : bound;
+        stack[top].node = 2 * node + 1, stack[top].depth = depth + 1, stack[top].bound = diff < 0 ? bound : far_bound, top++;
+        stack[top].node = 2 * node + 2, stack[top].depth = depth + 1, stack[top].bound = diff < 0 ? far_bound : bound, top++;
+    }
+    return found;
+}
+
+// Spread the low 21 bits of v so there are two zero bits between each
+static inline uint64_t spatial_spread_bits(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+}
+
+// Sort probes by Morton code, least significant digit first. Every thread
+// counts the digits of its own static chunk; a prefix sum over (digit,
+// thread) then gives each thread its own output slots, so the scatter needs
+// no synchronisation and every pass is stable. Returns the sorted array,
+// which is either order or scratch; the other one is free to reuse.
+static inline spatial_order_t *spatial_radix_sort(spatial_order_t *order, spatial_order_t *scratch, long n, int bits) {
+    int threads = omp_get_max_threads();
+    long *counts = malloc((size_t)threads * SPATIAL_RADIX * sizeof(long));
+    if (counts == NULL) {
+        return NULL;
+    }
+    for (int shift = 0; shift < bits; shift += SPATIAL_RADIX_BITS) {
+        #pragma omp parallel num_threads(threads)
+        {
+            int t = omp_get_thread_num(), nt = omp_get_num_threads();
+            long first = n * t / nt, last = n * (t + 1) / nt;
+            long *count = counts + (size_t)t * SPATIAL_RADIX;
+            for (int d = 0; d < SPATIAL_RADIX; d++) {
+                count[d] = 0;
+            }
+            for (long q = first; q < last; q++) {
+                count[(order[q].code >> shift) & (SPATIAL_RADIX - 1)]++;
+            }
+            #pragma omp barrier
+            #pragma omp single
+            {
+                long offset = 0;
+                for (int d = 0; d < SPATIAL_RADIX; d++) {
+                    for (int u = 0; u < nt; u++) {
+                        long c = counts[(size_t)u * SPATIAL_RADIX + d];
+                        counts[(size_t)u * SPATIAL_RADIX + d] = offset;
+                        offset += c;
+                    }
+                }
+            }
+            for (long q = first; q < last; q++) {
+                scratch[count[(order[q].code >> shift) & (SPATIAL_RADIX - 1)]++] = order[q];
+            }
+        }
+        spatial_order_t *temp = order;
+        order = scratch;
+        scratch = temp;
+    }
+    free(counts);
+    return order;
+}
+
+// Order probes along a Morton curve through their bounding box
+static inline spatial_order_t *spatial_morton_order(long n, const double *px, const double *py, const double *pz) {
+    spatial_order_t *order = malloc(n * sizeof(spatial_order_t));
+    spatial_order_t *scratch = malloc(n * sizeof(spatial_order_t));
+    if (order == NULL || scratch == NULL) {
+        free(order);
+        free(scratch);
+        return NULL;
+    }
+    const double *axis[3] = {px, py, pz};
+    double lo[3], scale[3];
+    for (int a = 0; a < 3; a++) {
+        double min = INFINITY, max = -INFINITY;
+        #pragma omp parallel for reduction(min : min) reduction(max : max)
+        for (long q = 0; q < n; q++) {
+            min = axis[a][q] < min ? axis[a][q] : min;
+            max = axis[a][q] > max ? axis[a][q] : max;
+        }
+        lo[a] = min;
+        scale[a] = max > min ? 2097151.0 / (max - min) : 0.0;
+    }
+
+    #pragma omp parallel for
+    for (long q = 0; q < n; q++) {
+        uint64_t code = 0;
+        for (int a = 0; a < 3; a++) {
+            code |= spatial_spread_bits((uint64_t)((axis[a][q] - lo[a]) * scale[a])) << a;
+        }
+        order[q].code = code;
+        order[q].probe = q;
+    }
+
+    // Three interleaved 21-bit coordinates fill 63 bits
+    spatial_order_t *sorted = spatial_radix_sort(order, scratch, n, 63);
+    if (sorted == NULL) {
+        free(order);
+        free(scratch);
+        return NULL;
+    }
+    free(sorted == order ? scratch : order);
+    return sorted;
+}
+
+// Nearest sample to each of n probes; distance2 may be NULL
+static inline int spatial_nearest_batch(const spatial_index_t *index, long n, const double *px, const double *py, const double *pz,
+                                        long *nearest, double *distance2) {
+    if (index->structured) {
+        #pragma omp parallel for schedule(static)
+        for (long q = 0; q < n; q++) {
+            double p[3] = {px[q], py[q], pz[q]}, d2;
+            nearest[q] = spatial_nearest(index, p, &d2);
+            if (distance2 != NULL) {
+                distance2[q] = d2;
+            }
+        }
+        return 0;
+    }
+
+    spatial_order_t *order = spatial_morton_order(n, px, py, pz);
+    if (order == NULL) {
+        return -1;
+    }
+    #pragma omp parallel for schedule(static)
+    for (long s = 0; s < n; s++) {
+        long q = order[s].probe;
+        double p[3] = {px[q], py[q], pz[q]}, d2;
+        nearest[q] = spatial_nearest(index, p, &d2);
+        if (distance2 != NULL) {
+            distance2[q] = d2;
+        }
+    }
+    free(order);
+    return 0;
+}
+
+// Containing cell of each of n probes (see spatial_locate). Only lattices
+// have cells, and locating in one is arithmetic, so the probes are not sorted.
+static inline int spatial_locate_batch(const spatial_index_t *index, long n, const double *px, const double *py, const double *pz, long *cells) {
+    #pragma omp parallel for schedule(static)
+    for (long q = 0; q < n; q++) {
+        double p[3] = {px[q], py[q], pz[q]};
+        cells[q] = spatial_locate(index, p);
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "wervel.h"
+
+// Parallel streamline tracer for the wervel vortex field
+//
+// Usage: streamlines <wervel.csv> <output.vtk> [x1 y1 z1 x2 y2 z2 resolution]
+//
+// The field is opened through wervel_open(), so after the first run the CSV
+// is not parsed again.
+//
+// Seeds are resolution + 1 points on the line from (x1, y1, z1) to
+// (x2, y2, z2), like the HighResLineSource in assignment6.pvsm. Without a
+// line the seeds run along z through the middle of the grid. Every seed is
+// traced forwards and backwards with adaptive Runge-Kutta 4-5 (Cash-Karp)
+// using the StreamTracer settings from the state file. Lines are traced in
+// batches of BATCH lanes that step in lock-step, so each Runge-Kutta stage
+// interpolates the field at BATCH points in one vectorised call, and batches
+// are spread over the OpenMP threads. The result is a binary legacy VTK
+// polydata file with the velocity at every point.
+
+#define BATCH 8
+#define DEFAULT_RESOLUTION 100
+#define INITIAL_STEP 0.2      // In cell lengths
+#define MINIMUM_STEP 0.01
+#define MAXIMUM_STEP 0.5
+#define MAXIMUM_ERROR 1e-6
+#define MAXIMUM_STEPS 2000
+#define MAXIMUM_PROPAGATION 121.0
+#define TERMINAL_SPEED 1e-12
+
+// One traced polyline with its velocity samples
+typedef struct {
+    float *points;
+    float *velocity;
+    int count;
+    int capacity;
+} polyline_t;
+
+// Function prototypes
+void trace_batch(const wervel_field_t *field, const double (*seeds)[3], const int *directions, int n, polyline_t *lines, double cell_length);
+void append_point(polyline_t *line, const double p[3], const double v[3]);
+void write_vtk(const char *path, polyline_t *lines, int num_lines);
+
+int main(int argc, char **argv) {
+    if (argc != 3 && argc != 10) {
+        fprintf(stderr, "Usage: %s <wervel.csv> <output.vtk> [x1 y1 z1 x2 y2 z2 resolution]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    double start = omp_get_wtime();
+    wervel_field_t field;
+    if (wervel_open(argv[1], &field) != 0) {
+        return EXIT_FAILURE;
+    }
+    double loaded = omp_get_wtime();
+
+    double p1[3], p2[3];
+    int resolution = DEFAULT_RESOLUTION;
+    if (argc == 10) {
+        for (int a = 0; a < 3; a++) {
+            p1[a] = atof(argv[3 + a]);
+            p2[a] = atof(argv[6 + a]);
+        }
+        resolution = atoi(argv[9]);
+        if (resolution < 1) {
+            fprintf(stderr, "Resolution must be at least 1.\n");
+            return EXIT_FAILURE;
+        }
+    } else {
+        for (int a = 0; a < 3; a++) {
+            p1[a] = p2[a] = field.origin[a] + 0.5 * (field.dims[a] - 1) * field.spacing[a];
+        }
+        p1[2] = field.origin[2];
+        p2[2] = field.origin[2] + (field.dims[2] - 1) * field.spacing[2];
+    }
+
+    // Step sizes are given in cell lengths, like IntegrationStepUnit in the state file
+    double cell_length = fmin(field.spacing[0], fmin(field.spacing[1], field.spacing[2]));
+
+    // Line 2s is the backward trace of seed s, line 2s + 1 the forward trace
+    int num_seeds = resolution + 1;
+    int num_lines = 2 * num_seeds;
+    double (*seeds)[3] = malloc(num_lines * sizeof(*seeds));
+    int *directions = malloc(num_lines * sizeof(int));
+    polyline_t *lines = calloc(num_lines, sizeof(polyline_t));
+    if (seeds == NULL || directions == NULL || lines == NULL) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return EXIT_FAILURE;
+    }
+    for (int s = 0; s < num_seeds; s++) {
+        double t = (double)s / resolution;
+        for (int d = 0; d < 2; d++) {
+            for (int a = 0; a < 3; a++) {
+                seeds[2 * s + d][a] = p1[a] + t * (p2[a] - p1[a]);
+            }
+            directions[2 * s + d] = d == 0 ? -1 : 1;
+        }
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int first = 0; first < num_lines; first += BATCH) {
+        int n = num_lines - first < BATCH ? num_lines - first : BATCH;
+        trace_batch(&field, seeds + first, directions + first, n, lines + first, cell_length);
+    }
+    double traced = omp_get_wtime();
+
+    write_vtk(argv[2], lines, num_lines);
+
+    long total_points = 0;
+    for (int l = 0; l < num_lines; l++) {
+        total_points += lines[l].count;
+    }
+    printf("Grid %dx%dx%d, %d seeds, %ld points\n", field.dims[0], field.dims[1], field.dims[2], num_seeds, total_points);
+    printf("Load: %.6fs, trace: %.3fs (%d threads)\n", loaded - start, traced - loaded, omp_get_max_threads());
+
+    for (int l = 0; l < num_lines; l++) {
+        free(lines[l].points);
+        free(lines[l].velocity);
+    }
+    free(lines);
+    free(directions);
+    free(seeds);
+    wervel_free(&field);
+    return EXIT_SUCCESS;
+}
+
+// Trace up to BATCH lines in lock-step until all of them have terminated
+void trace_batch(const wervel_field_t *field, const double (*seeds)[3], const int *directions, int n, polyline_t *lines, double cell_length) {
+    // Cash-Karp tableau
+    static const double a[6][5] = {
+        {0, 0, 0, 0, 0},
+        {1.0 / 5, 0, 0, 0, 0},
+        {3.0 / 40, 9.0 / 40, 0, 0, 0},
+        {3.0 / 10, -9.0 / 10, 6.0 / 5, 0, 0},
+        {-11.0 / 54, 5.0 / 2, -70.0 / 27, 35.0 / 27, 0},
+        {1631.0 / 55296, 175.0 / 512, 575.0 / 13824, 44275.0 / 110592, 253.0 / 4096},
+    };
+    static const double b5[6] = {37.0 / 378, 0, 250.0 / 621, 125.0 / 594, 0, 512.0 / 1771};
+    static const double b4[6] = {2825.0 / 27648, 0, 18575.0 / 48384, 13525.0 / 55296, 277.0 / 14336, 1.0 / 4};
+
+    double pos[3][BATCH], stage[3][BATCH], k[6][3][BATCH], vel[3][BATCH];
+    double h[BATCH], length[BATCH];
+    int steps[BATCH], active[BATCH], accepted[BATCH], inside[BATCH], stage_inside[BATCH];
+
+    for (int l = 0; l < BATCH; l++) {
+        int s = l < n ? l : n - 1; // Idle lanes shadow the last line but never record
+        for (int d = 0; d < 3; d++) {
+            pos[d][l] = seeds[s][d];
+        }
+        h[l] = INITIAL_STEP * cell_length;
+        length[l] = 0.0;
+        steps[l] = 0;
+        active[l] = l < n;
+    }
+
+    wervel_sample3(field, WERVEL_VX, WERVEL_VY, WERVEL_VZ, BATCH, pos[0], pos[1], pos[2], vel[0], vel[1], vel[2], inside);
+    for (int l = 0; l < n; l++) {
+        active[l] = inside[l];
+        if (active[l]) {
+            double p[3] = {pos[0][l], pos[1][l], pos[2][l]};
+            double v[3] = {vel[0][l], vel[1][l], vel[2][l]};
+            append_point(&lines[l], p, v);
+        }
+    }
+
+    int any_active = 1;
+    while (any_active) {
+        // Integrate along arc length: the right-hand side is the unit velocity
+        for (int s = 0; s < 6; s++) {
+            for (int d = 0; d < 3; d++) {
+                for (int l = 0; l < BATCH; l++) {
+                    double offset = 0.0;
+                    for (int r = 0; r < s; r++) {
+                        offset += a[s][r] * k[r][d][l];
+                    }
+                    stage[d][l] = pos[d][l] + h[l] * offset;
+                }
+            }
+            wervel_sample3(field, WERVEL_VX, WERVEL_VY, WERVEL_VZ, BATCH, stage[0], stage[1], stage[2],
+                           k[s][0], k[s][1], k[s][2], stage_inside);
+            for (int l = 0; l < BATCH; l++) {
+                double speed = sqrt(k[s][0][l] * k[s][0][l] + k[s][1][l] * k[s][1][l] + k[s][2][l] * k[s][2][l]);
+                double scale = speed > TERMINAL_SPEED ? directions[l < n ? l : n - 1] / speed : 0.0;
+                for (int d = 0; d < 3; d++) {
+                    k[s][d][l] *= scale;
+                }
+                if (s == 0) {
+                    inside[l] = stage_inside[l] && speed > TERMINAL_SPEED;
+                } else {
+                    inside[l] &= stage_inside[l];
+                }
+            }
+        }
+
+        any_active = 0;
+        for (int l = 0; l < n; l++) {
+            accepted[l] = 0;
+            if (!active[l]) {
+                continue;
+            }
+
+            // Left the grid or stagnated: stop where we are
+            if (!inside[l]) {
+                active[l] = 0;
+                continue;
+            }
+
+            double next[3], error = 0.0;
+            for (int d = 0; d < 3; d++) {
+                double high = 0.0, low = 0.0;
+                for (int s = 0; s < 6; s++) {
+                    high += b5[s] * k[s][d][l];
+                    low += b4[s] * k[s][d][l];
+                }
+                next[d] = pos[d][l] + h[l] * high;
+                error += (h[l] * (high - low)) * (h[l] * (high - low));
+            }
+            error = sqrt(error);
+
+            double minimum = MINIMUM_STEP * cell_length, maximum = MAXIMUM_STEP * cell_length;
+            if (error > MAXIMUM_ERROR && h[l] > minimum) {
+                // Reject and retry with a smaller step
+                h[l] = fmax(minimum, 0.9 * h[l] * pow(MAXIMUM_ERROR / error, 0.25));
+                any_active = 1;
+                continue;
+            }
+
+            length[l] += h[l];
+            steps[l]++;
+            accepted[l] = 1;
+            for (int d = 0; d < 3; d++) {
+                pos[d][l] = next[d];
+            }
+            double grow = error > 0.0 ? 0.9 * pow(MAXIMUM_ERROR / error, 0.2) : 5.0;
+            h[l] = fmin(maximum, fmax(minimum, h[l] * fmin(grow, 5.0)));
+            active[l] = steps[l] < MAXIMUM_STEPS && length[l] < MAXIMUM_PROPAGATION * cell_length;
+        }
+
+        // Record accepted points with the velocity at their new position; a
+        // step that ends outside the grid terminates the line there
+        wervel_sample3(field, WERVEL_VX, WERVEL_VY, WERVEL_VZ, BATCH, pos[0], pos[1], pos[2], vel[0], vel[1], vel[2], inside);
+        for (int l = 0; l < n; l++) {
+            if (accepted[l] && inside[l]) {
+                double p[3] = {pos[0][l], pos[1][l], pos[2][l]};
+                double v[3] = {vel[0][l], vel[1][l], vel[2][l]};
+                append_point(&lines[l], p, v);
+            } else if (accepted[l]) {
+                active[l] = 0;
+            }
+            any_active |= active[l];
+        }
+    }
+}
+
+// Append a point to a polyline, growing it as needed
+void append_point(polyline_t *line, const double p[3], const double v[3]) {
+    if (line->count == line->capacity) {
+        line->capacity = line->capacity ? 2 * line->capacity : 64;
+        line->points = realloc(line->points, 3 * line->capacity * sizeof(float));
+        line->velocity = realloc(line->velocity, 3 * line->capacity * sizeof(float));
+        if (line->points == NULL || line->velocity == NULL) {
+            fprintf(stderr, "Memory allocation failed.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int d = 0; d < 3; d++) {
+        line->points[3 * line->count + d] = (float)p[d];
+        line->velocity[3 * line->count + d] = (float)v[d];
+    }
+    line->count++;
+}
+
+// Write all lines with at least two points as binary legacy VTK polydata
+void write_vtk(const char *path, polyline_t *lines, int num_lines) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Cannot write %s.\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    long num_points = 0;
+    int num_polylines = 0;
+    for (int l = 0; l < num_lines; l++) {
+        if (lines[l].count >= 2) {
+            num_points += lines[l].count;
+            num_polylines++;
+        }
+    }
+
+    fprintf(file, "# vtk DataFile Version 3.0\nwervel streamlines\nBINARY\nDATASET POLYDATA\n");
+    fprintf(file, "POINTS %ld float\n", num_points);
+    for (int l = 0; l < num_lines; l++) {
+        if (lines[l].count >= 2) {
+            wervel_write_big_endian(file, lines[l].points, 3 * lines[l].count);
+        }
+    }
+
+    fprintf(file, "\nLINES %d %ld\n", num_polylines, num_polylines + num_points);
+    int32_t next_point = 0;
+    for (int l = 0; l < num_lines; l++) {
+        if (lines[l].count < 2) {
+            continue;
+        }
+        int32_t count = lines[l].count;
+        wervel_write_big_endian(file, &count, 1);
+        for (int32_t p = 0; p < count; p++) {
+            int32_t id = next_point + p;
+            wervel_write_big_endian(file, &id, 1);
+        }
+        next_point += count;
+    }
+
+    fprintf(file, "\nPOINT_DATA %ld\nVECTORS velocity float\n", num_points);
+    for (int l = 0; l < num_lines; l++) {
+        if (lines[l].count >= 2) {
+            wervel_write_big_endian(file, lines[l].velocity, 3 * lines[l].count);
+        }
+    }
+    fprintf(file, "\n");
+    fclose(file);
+}
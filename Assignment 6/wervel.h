@@ -0,0 +1,633 @@
+/* File: wervel.h */
+
+// Structured vortex field from course-data-20220113/wervel.csv
+//
+// The CSV lists one sample per line as "i, x, y, z, vx, vy, vz". The samples
+// sit on a regular lattice, so the loader recovers the grid dimensions and
+// spacing from the coordinates and stores every quantity as its own column in
+// grid order (x fastest, then y, then z). All functions are static inline so
+// a tool only has to include this header.
+//
+// wervel_open() is the usual entry point. The first time it parses the CSV
+// in parallel chunks and writes a binary cache next to it (<csv>.cache) with
+// every column 64-byte aligned. Later calls map the cache and point the
+// columns straight into the mapping, so no parsing or copying happens.
+
+#ifndef WERVEL_H
+#define WERVEL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <omp.h>
+
+#define WERVEL_MAX_COLUMNS 16
+#define WERVEL_NAME_LENGTH 16
+#define WERVEL_CACHE_MAGIC "WERVEL1"
+#define WERVEL_CACHE_ALIGNMENT 64
+#define WERVEL_LATTICE_TOLERANCE 1e-3 // In cells
+
+// Columns present in every field, in this order
+enum { WERVEL_X, WERVEL_Y, WERVEL_Z, WERVEL_VX, WERVEL_VY, WERVEL_VZ, WERVEL_NUM_INPUT_COLUMNS };
+
+static const char *wervel_input_names[WERVEL_NUM_INPUT_COLUMNS] = {"x", "y", "z", "vx", "vy", "vz"};
+
+typedef struct {
+    long num_points;
+    int dims[3];
+    double origin[3];
+    double spacing[3];
+    int num_columns;
+    char names[WERVEL_MAX_COLUMNS][WERVEL_NAME_LENGTH];
+    float *columns[WERVEL_MAX_COLUMNS];
+    int owned[WERVEL_MAX_COLUMNS]; // Allocated with malloc rather than mapped
+    void *mapping;
+    size_t mapping_size;
+} wervel_field_t;
+
+// Layout of the start of a cache file; the columns follow at the given offsets
+typedef struct {
+    char magic[8];
+    int64_t num_points;
+    int32_t dims[3];
+    int32_t num_columns;
+    double origin[3];
+    double spacing[3];
+    int64_t source_size;
+    int64_t source_mtime;
+    char names[WERVEL_MAX_COLUMNS][WERVEL_NAME_LENGTH];
+    uint64_t offsets[WERVEL_MAX_COLUMNS];
+} wervel_cache_header_t;
+
+// Index of a named column, or -1
+static inline int wervel_column(const wervel_field_t *field, const char *name) {
+    for (int c = 0; c < field->num_columns; c++) {
+        if (strcmp(field->names[c], name) == 0) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+// Add an uninitialised column and return its index, or -1 if there is no room
+static inline int wervel_add_column(wervel_field_t *field, const char *name) {
+    if (field->num_columns == WERVEL_MAX_COLUMNS) {
+        return -1;
+    }
+    int c = field->num_columns;
+    field->columns[c] = malloc(field->num_points * sizeof(float));
+    if (field->columns[c] == NULL) {
+        return -1;
+    }
+    snprintf(field->names[c], WERVEL_NAME_LENGTH, "%s", name);
+    field->owned[c] = 1;
+    field->num_columns++;
+    return c;
+}
+
+// Index of a named column, adding it if it does not exist yet
+static inline int wervel_ensure_column(wervel_field_t *field, const char *name) {
+    int c = wervel_column(field, name);
+    return c >= 0 ? c : wervel_add_column(field, name);
+}
+
+// Free all columns and unmap the cache
+static inline void wervel_free(wervel_field_t *field) {
+    for (int c = 0; c < field->num_columns; c++) {
+        if (field->owned[c]) {
+            free(field->columns[c]);
+        }
+    }
+    if (field->mapping != NULL) {
+        munmap(field->mapping, field->mapping_size);
+    }
+    field->num_columns = 0;
+    field->mapping = NULL;
+}
+
+// Slot of a sample on the grid, or -1 if its coordinates are not within
+// WERVEL_LATTICE_TOLERANCE cells of a grid point (NaN included)
+static inline long wervel_lattice_index(const wervel_field_t *field, const float *sample) {
+    long index = 0;
+    for (int a = 2; a >= 0; a--) {
+        double g = (sample[a] - field->origin[a]) / field->spacing[a];
+        if (!(g > -0.5 && g < field->dims[a] - 0.5)) {
+            return -1;
+        }
+        long k = lround(g);
+        if (fabs(g - k) > WERVEL_LATTICE_TOLERANCE) {
+            return -1;
+        }
+        index = index * field->dims[a] + k;
+    }
+    return index;
+}
+
+// Work out the lattice from raw samples and scatter them into grid order.
+// raw holds WERVEL_NUM_INPUT_COLUMNS floats per sample.
+static inline int wervel_build_grid(wervel_field_t *field, const float *raw, long count) {
+    if (count < 1 || count > INT_MAX) {
+        fprintf(stderr, "wervel: need between 1 and %d samples.\n", INT_MAX);
+        return -1;
+    }
+
+    // Spacing along an axis is the smallest positive offset from its minimum
+    double lo[3], hi[3], step[3];
+    for (int a = 0; a < 3; a++) {
+        double axis_lo = raw[a], axis_hi = raw[a], axis_step = INFINITY;
+        #pragma omp parallel for reduction(min : axis_lo) reduction(max : axis_hi)
+        for (long p = 0; p < count; p++) {
+            double v = raw[p * WERVEL_NUM_INPUT_COLUMNS + a];
+            axis_lo = v < axis_lo ? v : axis_lo;
+            axis_hi = v > axis_hi ? v : axis_hi;
+        }
+        #pragma omp parallel for reduction(min : axis_step)
+        for (long p = 0; p < count; p++) {
+            double offset = raw[p * WERVEL_NUM_INPUT_COLUMNS + a] - axis_lo;
+            if (offset > 1e-6 && offset < axis_step) {
+                axis_step = offset;
+            }
+        }
+        lo[a] = axis_lo;
+        hi[a] = axis_hi;
+        step[a] = axis_step;
+    }
+
+    long cells = 1;
+    for (int a = 0; a < 3; a++) {
+        field->origin[a] = lo[a];
+        field->spacing[a] = isinf(step[a]) ? 1.0 : step[a];
+        double extent = (hi[a] - lo[a]) / field->spacing[a];
+        if (!(extent >= 0.0 && extent < count)) {
+            fprintf(stderr, "wervel: coordinates along axis %d are not finite or span more than %ld points.\n", a, count);
+            return -1;
+        }
+        field->dims[a] = (int)lround(extent) + 1;
+        cells *= field->dims[a];
+    }
+    if (cells != count) {
+        fprintf(stderr, "wervel: %ld samples do not form a %dx%dx%d structured grid.\n", count,
+                field->dims[0], field->dims[1], field->dims[2]);
+        return -1;
+    }
+
+    field->num_points = count;
+    field->num_columns = 0;
+    field->mapping = NULL;
+    field->mapping_size = 0;
+    for (int c = 0; c < WERVEL_NUM_INPUT_COLUMNS; c++) {
+        if (wervel_add_column(field, wervel_input_names[c]) < 0) {
+            fprintf(stderr, "wervel: out of memory.\n");
+            wervel_free(field);
+            return -1;
+        }
+    }
+
+    // Every sample has to sit on a lattice point of its own. With as many
+    // samples as slots, that also means every slot is filled.
+    atomic_uchar *filled = calloc(count, sizeof(atomic_uchar));
+    if (filled == NULL) {
+        fprintf(stderr, "wervel: out of memory.\n");
+        wervel_free(field);
+        return -1;
+    }
+    int on_lattice = 1;
+    #pragma omp parallel for reduction(& : on_lattice)
+    for (long p = 0; p < count; p++) {
+        long index = wervel_lattice_index(field, raw + p * WERVEL_NUM_INPUT_COLUMNS);
+        on_lattice &= index >= 0 && atomic_exchange_explicit(&filled[index], 1, memory_order_relaxed) == 0;
+    }
+    free(filled);
+    if (!on_lattice) {
+        fprintf(stderr, "wervel: samples are off the %dx%dx%d grid or repeat a grid point.\n",
+                field->dims[0], field->dims[1], field->dims[2]);
+        wervel_free(field);
+        return -1;
+    }
+
+    // Place every sample by its coordinates, so the file order does not matter
+    #pragma omp parallel for
+    for (long p = 0; p < count; p++) {
+        const float *sample = raw + p * WERVEL_NUM_INPUT_COLUMNS;
+        long index = wervel_lattice_index(field, sample);
+        for (int c = 0; c < WERVEL_NUM_INPUT_COLUMNS; c++) {
+            field->columns[c][index] = sample[c];
+        }
+    }
+    return 0;
+}
+
+// Parse a decimal number such as "-1.45" or "2e-3" and advance *cursor past
+// it. Returns 0 if there was no number. Much faster than strtod because it
+// skips locale handling and rounding corner cases that do not occur in this data.
+static inline int wervel_parse_number(const char **cursor, const char *end, double *value) {
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    const char *c = *cursor;
+    while (c < end && (*c == ' ' || *c == '\t' || *c == ',')) {
+        c++;
+    }
+
+    int negative = 0;
+    if (c < end && (*c == '-' || *c == '+')) {
+        negative = *c == '-';
+        c++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0, seen = 0;
+    for (; c < end && *c >= '0' && *c <= '9'; c++) {
+        seen = 1;
+        if (digits < 18) {
+            mantissa = mantissa * 10 + (*c - '0');
+            digits++;
+        } else {
+            exponent++;
+        }
+    }
+    if (c < end && *c == '.') {
+        for (c++; c < end && *c >= '0' && *c <= '9'; c++) {
+            seen = 1;
+            if (digits < 18) {
+                mantissa = mantissa * 10 + (*c - '0');
+                digits++;
+                exponent--;
+            }
+        }
+    }
+    if (seen && c < end && (*c == 'e' || *c == 'E')) {
+        c++;
+        int exponent_negative = 0, value = 0;
+        if (c < end && (*c == '-' || *c == '+')) {
+            exponent_negative = *c == '-';
+            c++;
+        }
+        for (; c < end && *c >= '0' && *c <= '9'; c++) {
+            value = value * 10 + (*c - '0');
+        }
+        exponent += exponent_negative ? -value : value;
+    }
+    *cursor = c;
+
+    double result = (double)mantissa;
+    if (exponent < 0) {
+        result = -exponent <= 18 ? result / powers[-exponent] : result * pow(10.0, exponent);
+    } else if (exponent > 0) {
+        result = exponent <= 18 ? result * powers[exponent] : result * pow(10.0, exponent);
+    }
+    *value = negative ? -result : result;
+    return seen;
+}
+
+// A data line starts with a digit or sign after optional blanks; the header does not
+static inline int wervel_is_data_line(const char *c, const char *end) {
+    while (c < end && (*c == ' ' || *c == '\t')) {
+        c++;
+    }
+    return c < end && ((*c >= '0' && *c <= '9') || *c == '-' || *c == '+' || *c == '.');
+}
+
+// Load the CSV, parsing one chunk of lines per thread
+static inline int wervel_load_csv(const char *path, wervel_field_t *field) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0) {
+        fprintf(stderr, "wervel: cannot open %s.\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    size_t size = info.st_size;
+    const char *text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        fprintf(stderr, "wervel: cannot map %s.\n", path);
+        return -1;
+    }
+    const char *end = text + size;
+
+    // Chunk boundaries are moved forward to the start of the next line
+    int num_chunks = omp_get_max_threads();
+    const char **bounds = malloc((num_chunks + 1) * sizeof(const char *));
+    long *lines_before = calloc(num_chunks + 1, sizeof(long));
+    if (bounds == NULL || lines_before == NULL) {
+        fprintf(stderr, "wervel: out of memory.\n");
+        munmap((void *)text, size);
+        return -1;
+    }
+    bounds[0] = text;
+    bounds[num_chunks] = end;
+    for (int t = 1; t < num_chunks; t++) {
+        const char *c = text + size * t / num_chunks;
+        if (c < bounds[t - 1]) {
+            c = bounds[t - 1];
+        }
+        while (c < end && c > text && c[-1] != '\n') {
+            c++;
+        }
+        bounds[t] = c;
+    }
+
+    // First pass counts data lines per chunk so every chunk knows where to write
+    #pragma omp parallel for
+    for (int t = 0; t < num_chunks; t++) {
+        long lines = 0;
+        for (const char *line = bounds[t]; line < bounds[t + 1];) {
+            const char *next = memchr(line, '\n', bounds[t + 1] - line);
+            next = next != NULL ? next + 1 : bounds[t + 1];
+            lines += wervel_is_data_line(line, next);
+            line = next;
+        }
+        lines_before[t + 1] = lines;
+    }
+    for (int t = 0; t < num_chunks; t++) {
+        lines_before[t + 1] += lines_before[t];
+    }
+    long count = lines_before[num_chunks];
+
+    float *raw = malloc(count * WERVEL_NUM_INPUT_COLUMNS * sizeof(float) + 1);
+    int malformed = 0;
+    if (raw != NULL) {
+        #pragma omp parallel for reduction(| : malformed)
+        for (int t = 0; t < num_chunks; t++) {
+            float *out = raw + lines_before[t] * WERVEL_NUM_INPUT_COLUMNS;
+            for (const char *line = bounds[t]; line < bounds[t + 1];) {
+                const char *next = memchr(line, '\n', bounds[t + 1] - line);
+                next = next != NULL ? next + 1 : bounds[t + 1];
+                if (wervel_is_data_line(line, next)) {
+                    // The leading sample index is implied by the coordinates
+                    const char *c = line;
+                    double value;
+                    malformed |= !wervel_parse_number(&c, next, &value);
+                    for (int k = 0; k < WERVEL_NUM_INPUT_COLUMNS; k++) {
+                        malformed |= !wervel_parse_number(&c, next, &value);
+                        *out++ = (float)value;
+                    }
+                }
+                line = next;
+            }
+        }
+    }
+    munmap((void *)text, size);
+    free(bounds);
+    free(lines_before);
+
+    if (raw == NULL) {
+        fprintf(stderr, "wervel: out of memory.\n");
+        return -1;
+    }
+    if (malformed) {
+        fprintf(stderr, "wervel: %s has lines with fewer than seven values.\n", path);
+        free(raw);
+        return -1;
+    }
+    int status = wervel_build_grid(field, raw, count);
+    free(raw);
+    return status;
+}
+
+// Write every column of a field to a cache file, tagged with the source's size and time
+static inline int wervel_write_cache(const wervel_field_t *field, const char *cache_path, const struct stat *source) {
+    wervel_cache_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, WERVEL_CACHE_MAGIC, sizeof(WERVEL_CACHE_MAGIC));
+    header.num_points = field->num_points;
+    header.num_columns = field->num_columns;
+    for (int a = 0; a < 3; a++) {
+        header.dims[a] = field->dims[a];
+        header.origin[a] = field->origin[a];
+        header.spacing[a] = field->spacing[a];
+    }
+    header.source_size = source->st_size;
+    header.source_mtime = source->st_mtime;
+
+    size_t column_bytes = field->num_points * sizeof(float);
+    size_t padded = (column_bytes + WERVEL_CACHE_ALIGNMENT - 1) / WERVEL_CACHE_ALIGNMENT * WERVEL_CACHE_ALIGNMENT;
+    uint64_t offset = (sizeof(header) + WERVEL_CACHE_ALIGNMENT - 1) / WERVEL_CACHE_ALIGNMENT * WERVEL_CACHE_ALIGNMENT;
+    for (int c = 0; c < field->num_columns; c++) {
+        memcpy(header.names[c], field->names[c], WERVEL_NAME_LENGTH);
+        header.offsets[c] = offset;
+        offset += padded;
+    }
+
+    // Write to a temporary name and rename, so readers never map a half-written file
+    char temp_path[4096 + 32];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp.%d", cache_path, (int)getpid());
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    static const char zeros[WERVEL_CACHE_ALIGNMENT] = {0};
+    size_t written = sizeof(header);
+    for (int c = 0; c < field->num_columns && ok; c++) {
+        ok &= fwrite(zeros, 1, header.offsets[c] - written, file) == header.offsets[c] - written;
+        ok &= fwrite(field->columns[c], 1, column_bytes, file) == column_bytes;
+        written = header.offsets[c] + column_bytes;
+    }
+    ok &= fclose(file) == 0;
+    if (!ok || rename(temp_path, cache_path) != 0) {
+        unlink(temp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// Check that a cache header describes a grid whose columns all lie inside the
+// file, so a stale or corrupt cache cannot send interpolation out of bounds.
+// Sizes are compared by division, so a huge header value cannot overflow.
+static inline int wervel_valid_header(const wervel_cache_header_t *header, uint64_t file_size) {
+    if (header->num_columns < WERVEL_NUM_INPUT_COLUMNS || header->num_columns > WERVEL_MAX_COLUMNS ||
+        header->num_points < 1 || header->num_points > INT_MAX) {
+        return 0;
+    }
+    int64_t points = 1;
+    for (int a = 0; a < 3; a++) {
+        if (header->dims[a] < 1 || header->dims[a] > header->num_points / points ||
+            !(header->spacing[a] > 0.0) || !isfinite(header->spacing[a]) || !isfinite(header->origin[a])) {
+            return 0;
+        }
+        points *= header->dims[a];
+    }
+    if (points != header->num_points) {
+        return 0;
+    }
+
+    uint64_t column_bytes = (uint64_t)header->num_points * sizeof(float);
+    for (int c = 0; c < header->num_columns; c++) {
+        uint64_t offset = header->offsets[c];
+        if (offset < sizeof(wervel_cache_header_t) || offset % WERVEL_CACHE_ALIGNMENT != 0 || offset > file_size ||
+            column_bytes > file_size - offset) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Map a cache file if it is valid and matches the source; columns point into the mapping
+static inline int wervel_map_cache(wervel_field_t *field, const char *cache_path, const struct stat *source) {
+    int fd = open(cache_path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(wervel_cache_header_t)) {
+        close(fd);
+        return -1;
+    }
+    // Copy-on-write, so tools may scribble on columns without touching the file
+    void *mapping = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return -1;
+    }
+
+    const wervel_cache_header_t *header = mapping;
+    int valid = memcmp(header->magic, WERVEL_CACHE_MAGIC, sizeof(WERVEL_CACHE_MAGIC)) == 0 &&
+                header->source_size == source->st_size && header->source_mtime == source->st_mtime &&
+                wervel_valid_header(header, (uint64_t)info.st_size);
+    if (!valid) {
+        munmap(mapping, info.st_size);
+        return -1;
+    }
+
+    field->num_points = header->num_points;
+    field->num_columns = header->num_columns;
+    for (int a = 0; a < 3; a++) {
+        field->dims[a] = header->dims[a];
+        field->origin[a] = header->origin[a];
+        field->spacing[a] = header->spacing[a];
+    }
+    for (int c = 0; c < field->num_columns; c++) {
+        memcpy(field->names[c], header->names[c], WERVEL_NAME_LENGTH);
+        field->names[c][WERVEL_NAME_LENGTH - 1] = '\0';
+        field->columns[c] = (float *)((char *)mapping + header->offsets[c]);
+        field->owned[c] = 0;
+    }
+    field->mapping = mapping;
+    field->mapping_size = info.st_size;
+    return 0;
+}
+
+// Store the field, including any columns added since it was opened, as the
+// cache of a CSV file
+static inline int wervel_save(const char *csv_path, const wervel_field_t *field) {
+    struct stat source;
+    char cache_path[4096];
+    snprintf(cache_path, sizeof(cache_path), "%s.cache", csv_path);
+    if (stat(csv_path, &source) != 0 || wervel_write_cache(field, cache_path, &source) != 0) {
+        fprintf(stderr, "wervel: could not write cache %s.\n", cache_path);
+        return -1;
+    }
+    return 0;
+}
+
+// Open the field behind a CSV file through its cache, building the cache if
+// it is missing or older than the CSV
+static inline int wervel_open(const char *csv_path, wervel_field_t *field) {
+    struct stat source;
+    if (stat(csv_path, &source) != 0) {
+        fprintf(stderr, "wervel: cannot open %s.\n", csv_path);
+        return -1;
+    }
+    char cache_path[4096];
+    snprintf(cache_path, sizeof(cache_path), "%s.cache", csv_path);
+
+    if (wervel_map_cache(field, cache_path, &source) == 0) {
+        return 0;
+    }
+    if (wervel_load_csv(csv_path, field) != 0) {
+        return -1;
+    }
+    if (wervel_write_cache(field, cache_path, &source) != 0) {
+        fprintf(stderr, "wervel: warning, could not write cache %s.\n", cache_path);
+    }
+    return 0;
+}
+
+// Legacy VTK binary data is big-endian; write 4 byte values in that order
+static inline void wervel_write_big_endian(FILE *file, const void *data, size_t count) {
+    const uint32_t probe = 1;
+    int little_endian = *(const uint8_t *)&probe == 1;
+    const uint32_t *words = data;
+    uint32_t buffer[1024];
+    while (count > 0) {
+        size_t n = count < 1024 ? count : 1024;
+        for (size_t i = 0; i < n; i++) {
+            uint32_t w = words[i];
+            buffer[i] = little_endian ? (w >> 24) | ((w >> 8) & 0xff00) | ((w << 8) & 0xff0000) | (w << 24) : w;
+        }
+        fwrite(buffer, sizeof(uint32_t), n, file);
+        words += n;
+        count -= n;
+    }
+}
+
+// Trilinearly interpolate three columns at a batch of (finite) points. Points
+// outside the grid get inside[p] = 0 and a zero result. The loop has no
+// branches: grid parameters live in locals, cell indices are clamped as ints
+// and every result is computed and then multiplied by its inside flag. gcc
+// -O3 -march=native vectorises it across the batch with gathers for the
+// eight corners (check with -fopt-info-vec).
+static inline void wervel_sample3(const wervel_field_t *field, int cu, int cv, int cw, int n,
+                                  const double *restrict px, const double *restrict py, const double *restrict pz,
+                                  double *restrict u, double *restrict v, double *restrict w, int *restrict inside) {
+    const float *restrict fu = field->columns[cu];
+    const float *restrict fv = field->columns[cv];
+    const float *restrict fw = field->columns[cw];
+    const int nx = field->dims[0], ny = field->dims[1], nz = field->dims[2];
+    const double ox = field->origin[0], oy = field->origin[1], oz = field->origin[2];
+    const double rx = 1.0 / field->spacing[0], ry = 1.0 / field->spacing[1], rz = 1.0 / field->spacing[2];
+    const double hx = nx - 1, hy = ny - 1, hz = nz - 1;
+
+    // Last cell along each axis, and the corner offsets (0 along flat axes)
+    const int ix = nx > 1 ? nx - 2 : 0, iy = ny > 1 ? ny - 2 : 0, iz = nz > 1 ? nz - 2 : 0;
+    const int sy = nx, sz = nx * ny;
+    const int dx = nx > 1 ? 1 : 0, dy = ny > 1 ? sy : 0, dz = nz > 1 ? sz : 0;
+
+    #pragma omp simd
+    for (int p = 0; p < n; p++) {
+        double gx = (px[p] - ox) * rx;
+        double gy = (py[p] - oy) * ry;
+        double gz = (pz[p] - oz) * rz;
+        int in = (gx >= 0.0) & (gy >= 0.0) & (gz >= 0.0) & (gx <= hx) & (gy <= hy) & (gz <= hz);
+
+        // Clamp the cell so the last one is used on the upper faces and the
+        // lookups of outside points stay in range; their result is dropped
+        const double keep = in;
+        int i = (int)gx, j = (int)gy, k = (int)gz;
+        i = i > ix ? ix : i;
+        j = j > iy ? iy : j;
+        k = k > iz ? iz : k;
+        i = i < 0 ? 0 : i;
+        j = j < 0 ? 0 : j;
+        k = k < 0 ? 0 : k;
+        double tx = gx - i, ty = gy - j, tz = gz - k;
+
+        int c000 = i + j * sy + k * sz;
+        double w000 = (1 - tx) * (1 - ty) * (1 - tz), w100 = tx * (1 - ty) * (1 - tz);
+        double w010 = (1 - tx) * ty * (1 - tz), w110 = tx * ty * (1 - tz);
+        double w001 = (1 - tx) * (1 - ty) * tz, w101 = tx * (1 - ty) * tz;
+        double w011 = (1 - tx) * ty * tz, w111 = tx * ty * tz;
+
+        #define WERVEL_LERP(f) (w000 * f[c000] + w100 * f[c000 + dx] + w010 * f[c000 + dy] + w110 * f[c000 + dx + dy] + \
+                                w001 * f[c000 + dz] + w101 * f[c000 + dx + dz] + w011 * f[c000 + dy + dz] + w111 * f[c000 + dx + dy + dz])
+        double a = WERVEL_LERP(fu), b = WERVEL_LERP(fv), c = WERVEL_LERP(fw);
+        u[p] = keep * a;
+        v[p] = keep * b;
+        w[p] = keep * c;
+        #undef WERVEL_LERP
+        inside[p] = in;
+    }
+}
+
+#endif